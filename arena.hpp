@@ -0,0 +1,74 @@
+#ifndef OPL_ARENA_HPP
+#define OPL_ARENA_HPP
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator owning everything one compilation produces: AST nodes, type
+// nodes and the strings they refer to. Memory is carved out of large blocks and
+// released in one shot when the arena is destroyed; objects that still need a
+// destructor (nodes holding vectors or maps) are recorded and finalized first.
+class Arena {
+public:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    Arena() = default;
+
+    Arena(const Arena&) = delete;
+
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        for (auto i = finalizers.rbegin(); i != finalizers.rend(); ++i)
+            i->destroy(i->object);
+        for (auto block : blocks)
+            std::free(block);
+    }
+
+    void* allocate(size_t size, size_t align) {
+        size_t offset = (used + align - 1) & ~(align - 1);
+        if (blocks.empty() || offset + size > capacity) {
+            capacity = (size + align > BLOCK_SIZE)? size + align : BLOCK_SIZE;
+            blocks.push_back((char*)std::malloc(capacity));
+            if (!blocks.back()) throw std::bad_alloc();
+            used = 0;
+            offset = (align - (uintptr_t)blocks.back() % align) % align;
+        }
+        used = offset + size;
+        return blocks.back() + offset;
+    }
+
+    template<class T, class... Args>
+    T* make(Args&&... args) {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value)
+            finalizers.push_back({object, [](void* p) { ((T*)p)->~T(); }});
+        return object;
+    }
+
+    std::string_view copy(std::string_view text) {
+        if (text.empty()) return {};
+        char* data = (char*)allocate(text.size(), 1);
+        std::memcpy(data, text.data(), text.size());
+        return {data, text.size()};
+    }
+
+private:
+    struct Finalizer {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    std::vector<char*> blocks;
+    std::vector<Finalizer> finalizers;
+    size_t used = 0;
+    size_t capacity = 0;
+};
+
+#endif
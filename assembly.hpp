@@ -5,35 +5,134 @@
 #ifndef OPL_ASSEMBLY_HPP
 #define OPL_ASSEMBLY_HPP
 
-enum {
-    IMPORT_MODULE,
-
-    STACK_ADD,
-    STACK_SUB,
-    STACK_DIV,
-    STACK_MUL,
-    STACK_MOD,
-    STACK_LEFT,
-    STACK_RIGHT,
-    STACK_POW,
+// Instruction set of the VirtualMachine. Each instruction is an opcode followed
+// by its operands in the same std::vector<int>; the comment after an opcode
+// lists its operands. `name` operands index Bytecode::names, `k` operands
+// Bytecode::constants and `target` operands are code addresses.
+//
+// A call expects [args..., this, callee] on the operand stack and leaves the
+// result in their place. They stay where they are as the callee's first
+// locals, so a frame is laid out as [args..., this, callee, block locals...].
+//
+// The list is an X-macro so the VM can build its dispatch table in the same order.
 
-    POP,
-    PUSH,
-    LOAD,
-    STORE,
+#define OPL_OPCODES(X) \
+    X(IMPORT_MODULE)    /* name: runs the module once, pushes Null */ \
+    /* Binary operators, in the order of the parser's Operator enum. */ \
+    X(STACK_ADD) \
+    X(STACK_SUB) \
+    X(STACK_MUL) \
+    X(STACK_DIV) \
+    X(STACK_MOD) \
+    X(STACK_POW) \
+    X(STACK_BIT_AND) \
+    X(STACK_BIT_OR) \
+    X(STACK_BIT_XOR) \
+    X(STACK_LEFT) \
+    X(STACK_RIGHT) \
+    X(STACK_EQ) \
+    X(STACK_NOT_EQ) \
+    X(STACK_LESS) \
+    X(STACK_BIG) \
+    X(STACK_LESS_OR_EQ) \
+    X(STACK_BIG_OR_EQ) \
+    X(STACK_AND) \
+    X(STACK_OR) \
+    \
+    X(STACK_NOT) \
+    X(STACK_NEG) \
+    X(STACK_BIT_NOT) \
+    \
+    X(POP) \
+    X(PUSH)             /* k */ \
+    X(PUSH_STRING)      /* name: a new String with that text */ \
+    X(LOAD)             /* local */ \
+    X(LOAD_CHECKED)     /* local, name: fails on an unset `this` */ \
+    X(STORE)            /* local */ \
+    X(LOAD_GLOBAL)      /* name, cached root slot */ \
+    X(STORE_GLOBAL)     /* name, cached root slot */ \
+    X(DEFINE_GLOBAL)    /* name */ \
+    \
+    X(JMP)              /* target */ \
+    X(JMP_IF_TRUE)      /* target */ \
+    X(JMP_IF_FALSE)     /* target */ \
+    X(CALL)             /* argument count, name of the callee or -1 */ \
+    X(RETURN) \
+    X(LEAVE)            /* returns Null */ \
+    X(HALT) \
+    \
+    X(NEW_OBJECT)       /* class name, cached root slot, constructor argument count or -1 without "()" */ \
+    X(NEW_ARRAY)        /* element count */ \
+    X(MAKE_FUNCTION)    /* function index */ \
+    X(MAKE_CLASS)       /* name, member count, member names... */ \
+    X(MEMBER_GET)       /* name */ \
+    X(MEMBER_SET)       /* name */ \
+    X(ELEMENT_GET) \
+    X(ELEMENT_SET) \
+    X(STACK_COPY) \
+    X(STACK_PICK)       /* depth: copies the value that many below the top */ \
+    X(STACK_SWAP) \
+    X(DEEP_COPY) \
+    \
+    /* Register forms, emitted by the Compiler when asked to: three-address */ \
+    /* operations over frame slots. A source operand `a` or `b` is a local */ \
+    /* slot, or ~k for constant k. */ \
+    X(REG_ADD)          /* dst, a, b; binary operators as for STACK_ADD.. */ \
+    X(REG_SUB) \
+    X(REG_MUL) \
+    X(REG_DIV) \
+    X(REG_MOD) \
+    X(REG_POW) \
+    X(REG_BIT_AND) \
+    X(REG_BIT_OR) \
+    X(REG_BIT_XOR) \
+    X(REG_LEFT) \
+    X(REG_RIGHT) \
+    X(REG_EQ) \
+    X(REG_NOT_EQ) \
+    X(REG_LESS) \
+    X(REG_BIG) \
+    X(REG_LESS_OR_EQ) \
+    X(REG_BIG_OR_EQ) \
+    X(REG_AND) \
+    X(REG_OR) \
+    X(REG_NOT)          /* dst, a */ \
+    X(REG_NEG)          /* dst, a */ \
+    X(REG_BIT_NOT)      /* dst, a */ \
+    X(REG_MOVE)         /* dst, a */ \
+    X(REG_COPY)         /* dst, a: stores a copy, as `=` does */ \
+    X(REG_JMP_IF_FALSE) /* a, target */ \
+    \
+    /* Quickened forms. The VM rewrites a generic instruction in place into */ \
+    /* one of these after seeing operands of the kinds named, and back when */ \
+    /* its guard fails; the compiler never emits them. */ \
+    X(ADD_INT_INT) \
+    X(SUB_INT_INT) \
+    X(MUL_INT_INT) \
+    X(MOD_INT_INT) \
+    X(EQ_INT_INT) \
+    X(NOT_EQ_INT_INT) \
+    X(LESS_INT_INT) \
+    X(BIG_INT_INT) \
+    X(LESS_OR_EQ_INT_INT) \
+    X(BIG_OR_EQ_INT_INT) \
+    X(REG_ADD_INT_INT) \
+    X(REG_SUB_INT_INT) \
+    X(REG_MUL_INT_INT) \
+    X(REG_MOD_INT_INT) \
+    X(REG_EQ_INT_INT) \
+    X(REG_NOT_EQ_INT_INT) \
+    X(REG_LESS_INT_INT) \
+    X(REG_BIG_INT_INT) \
+    X(REG_LESS_OR_EQ_INT_INT) \
+    X(REG_BIG_OR_EQ_INT_INT) \
+    X(ELEMENT_GET_ARRAY_INT)
 
-    JMP,
-    JMP_IF_TRUE,
-    JMP_IF_FALSE,
-    CALL,
-    RETURN,
-    LEAVE,
-    HALT,
+#define OPL_OPCODE_ENUM(op) op,
 
-    NEW_OBJECT,
-    MEMBER_SET,
-    STACK_COPY,
-    DEEP_COPY
+enum {
+    OPL_OPCODES(OPL_OPCODE_ENUM)
+    OPCODE_COUNT
 };
 
 #endif //OPL_ASSEMBLY_HPP
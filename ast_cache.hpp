@@ -0,0 +1,222 @@
+#ifndef OPL_AST_CACHE_HPP
+#define OPL_AST_CACHE_HPP
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <filesystem>
+#include "flat_ast.hpp"
+#include "file.hpp"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+// ======= Parsed-AST cache
+// A FlatAST depends only on the bytes of its source, so the arrays of a parsed
+// file are written to a cache directory under the hash of those bytes. Running
+// a file whose content was seen before loads the arrays back and skips the
+// lexer and the parser; the same library module imported from several scripts
+// shares one entry.
+//
+// The directory is $OPL_CACHE_DIR, else $XDG_CACHE_HOME/opl, ~/.cache/opl or
+// %LOCALAPPDATA%\opl. Setting OPL_CACHE_DIR to an empty string turns the cache
+// off. Entries are written to a temporary file and renamed into place, so
+// scripts starting at the same time never see a half-written entry. An entry
+// that cannot be read, does not match or fails FlatVerifier is ignored and the
+// file is parsed.
+//
+// Entries are also keyed on the build of the interpreter, so a rebuilt parser
+// or a changed FlatAST layout never reads arrays an older build wrote.
+
+class ASTCache {
+public:
+    static ASTCache& instance() {
+        static ASTCache cache;
+        return cache;
+    }
+
+    bool enabled() const { return !directory.empty(); }
+
+    FlatAST* load(std::string_view source) {
+        if (!enabled() || source.empty()) return nullptr;
+        auto file = MappedFile::open(entry(content_hash(source)));
+        std::string_view data = file->view();
+        Header header;
+        if (data.size() < sizeof(Header)) return nullptr;
+        std::memcpy(&header, data.data(), sizeof(Header));
+        if (!header.matches(source) || data.size() != sizeof(Header) + header.payload_size()) return nullptr;
+        auto ast = new FlatAST;
+        const char* p = data.data() + sizeof(Header);
+        read(p, ast->kinds, header.nodes);
+        read(p, ast->operands, header.nodes);
+        read(p, ast->extra, header.extra);
+        read(p, ast->ints, header.ints);
+        read(p, ast->floats, header.floats);
+        ast->pool.assign(p, header.pool), p += header.pool;
+        read(p, ast->strings, header.strings);
+        ast->program = header.program;
+        if (!FlatVerifier(*ast).program()) {
+            delete ast;
+            return nullptr;
+        }
+        return ast;
+    }
+
+    void store(std::string_view source, const FlatAST& ast) {
+        if (!enabled() || source.empty()) return;
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        Header header = Header::of(source, ast);
+        std::string path = entry(header.hash);
+        // Unique per store: preload threads may write the same entry at once.
+        static std::atomic<unsigned> stores{0};
+        std::string temp = path + "." + std::to_string(process_id()) + "." + std::to_string(stores++) + ".tmp";
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            if (!out) return;
+            out.write((const char*)&header, sizeof(Header));
+            write(out, ast.kinds);
+            write(out, ast.operands);
+            write(out, ast.extra);
+            write(out, ast.ints);
+            write(out, ast.floats);
+            out.write(ast.pool.data(), (std::streamsize)ast.pool.size());
+            write(out, ast.strings);
+            if (!out.flush()) {
+                out.close();
+                std::filesystem::remove(temp, error);
+                return;
+            }
+        }
+        std::filesystem::rename(temp, path, error);
+        if (error) std::filesystem::remove(temp, error);
+    }
+
+    // 64-bit hash of a whole source file, eight bytes per step.
+    static uint64_t content_hash(std::string_view text) {
+        const uint64_t K1 = 0x9E3779B97F4A7C15ull, K2 = 0xC2B2AE3D27D4EB4Full;
+        uint64_t h = text.size() * K1;
+        size_t i = 0;
+        for (; i + 8 <= text.size(); i += 8) {
+            uint64_t w;
+            std::memcpy(&w, text.data() + i, 8);
+            h = rotate(h ^ (w * K2), 31) * K1;
+        }
+        uint64_t tail = 0;
+        if (i < text.size()) std::memcpy(&tail, text.data() + i, text.size() - i);
+        h = rotate(h ^ (tail * K2), 31) * K1;
+        h ^= h >> 33, h *= K2, h ^= h >> 29;
+        return h;
+    }
+
+    // Changes with every build: the compile time plus the sizes the entry layout depends on.
+    static uint64_t build_id() {
+        static const uint64_t id = content_hash(std::string(__DATE__ " " __TIME__ " ")
+            + std::to_string(sizeof(FlatAST::Operands)) + " " + std::to_string(sizeof(FlatAST::StringRef)) + " "
+            + std::to_string(sizeof(long long)) + " " + std::to_string(AST::A_NEG) + " " + std::to_string(OP_COUNT));
+        return id;
+    }
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t byte_order;
+        uint64_t build, hash, source_size;
+        uint32_t nodes, extra, ints, floats, pool, strings;
+        int32_t program;
+
+        static Header of(std::string_view source, const FlatAST& ast) {
+            Header h;
+            std::memset(&h, 0, sizeof(Header));
+            std::memcpy(h.magic, "OPLA", 4);
+            h.build = build_id();
+            h.hash = content_hash(source), h.source_size = source.size();
+            h.nodes = (uint32_t)ast.kinds.size(), h.extra = (uint32_t)ast.extra.size();
+            h.ints = (uint32_t)ast.ints.size(), h.floats = (uint32_t)ast.floats.size();
+            h.pool = (uint32_t)ast.pool.size(), h.strings = (uint32_t)ast.strings.size();
+            h.program = ast.program;
+            h.byte_order = 0x01020304;
+            return h;
+        }
+
+        bool matches(std::string_view source) const {
+            return std::memcmp(magic, "OPLA", 4) == 0 && build == build_id() && byte_order == 0x01020304
+                && source_size == source.size() && hash == content_hash(source);
+        }
+
+        uint64_t payload_size() const {
+            return (uint64_t)nodes * (1 + sizeof(FlatAST::Operands)) + (uint64_t)extra * sizeof(int32_t)
+                + (uint64_t)ints * sizeof(long long) + (uint64_t)floats * sizeof(double) + pool
+                + (uint64_t)strings * sizeof(FlatAST::StringRef);
+        }
+    };
+
+    std::string directory;
+
+    ASTCache() {
+        if (const char* dir = std::getenv("OPL_CACHE_DIR")) {
+            directory = dir;
+        } else if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+            directory = std::string(xdg) + "/opl";
+#ifdef _WIN32
+        } else if (const char* local = std::getenv("LOCALAPPDATA")) {
+            directory = std::string(local) + "\\opl";
+#else
+        } else if (const char* home = std::getenv("HOME"); home && *home) {
+            directory = std::string(home) + "/.cache/opl";
+#endif
+        }
+    }
+
+    std::string entry(uint64_t hash) const {
+        static const char digits[] = "0123456789abcdef";
+        std::string name(33, '-');
+        uint64_t build = build_id();
+        for (int i = 15; i >= 0; --i, hash >>= 4, build >>= 4)
+            name[i] = digits[build & 15], name[i + 17] = digits[hash & 15];
+        return (std::filesystem::path(directory) / (name + ".ast")).string();
+    }
+
+    static inline uint64_t rotate(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    static int process_id() {
+#ifdef _WIN32
+        return _getpid();
+#else
+        return (int)getpid();
+#endif
+    }
+
+    template<class T>
+    static void read(const char*& p, std::vector<T>& out, uint32_t count) {
+        out.resize(count);
+        if (count) std::memcpy(out.data(), p, count * sizeof(T));
+        p += count * sizeof(T);
+    }
+
+    template<class T>
+    static void write(std::ofstream& out, const std::vector<T>& in) {
+        out.write((const char*)in.data(), (std::streamsize)(in.size() * sizeof(T)));
+    }
+};
+
+// Reads, lexes, parses and flattens a source file, or loads it from the cache
+// when the same content was parsed before. The pointer tree is freed on return.
+inline FlatAST* parse_file(const std::string& path) {
+    auto file = MappedFile::open(path);
+    ASTCache& cache = ASTCache::instance();
+    if (FlatAST* cached = cache.load(file->view())) return cached;
+    Lexer lexer(file);
+    Parser parser(lexer);
+    FlatAST* ast = flatten(parser.ast);
+    cache.store(file->view(), *ast);
+    return ast;
+}
+
+#endif
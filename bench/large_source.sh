@@ -0,0 +1,14 @@
+#!/bin/sh
+# Writes a script of N small functions (default 10000, about 490k AST nodes)
+# and a call to the last one, to time lexing, parsing and the AST cache.
+n=${1:-10000}
+awk -v n="$n" 'BEGIN {
+    for (i = 0; i < n; ++i) {
+        printf "def f%d(a: int, b: int) -> int {\n", i
+        printf "    let s: int = a * %d + b;\n", i
+        printf "    for (k: int = 0; k < 3; ++k) { s += (k << 1) - (a & 7); }\n"
+        printf "    if (s > %d) { return s - b; } else { return s + [1, 2, 3][a %% 3]; }\n", i
+        printf "}\n"
+    }
+    printf "Println(f%d(1, 2));\n", n - 1
+}'
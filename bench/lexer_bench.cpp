@@ -0,0 +1,31 @@
+// Lexes each file given on the command line five times per round and prints the
+// best of five rounds, for timing the scanning in scan.hpp. Build with the flags
+// under test, e.g. -O2 (SSE2 on x86-64), -O2 -mavx2, or -O2 -mno-sse2 for scalar.
+#include "../lexer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+int main(int argc, char** argv) {
+    for (int f = 1; f < argc; ++f) {
+        std::ifstream in(argv[f], std::ios::binary);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        std::string source = buffer.str();
+        double best = 1e9;
+        size_t tokens = 0;
+        for (int round = 0; round < 5; ++round) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < 5; ++i) {
+                Lexer lexer(source);
+                for (tokens = 0; lexer.next(); ++tokens);
+            }
+            std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+            best = std::min(best, took.count() / 5);
+        }
+        printf("%-24s %9zu tokens %8.0f MB/s\n", argv[f], tokens, source.size() / best / 1e6);
+    }
+    return 0;
+}
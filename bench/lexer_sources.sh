@@ -0,0 +1,16 @@
+#!/bin/sh
+# Writes the two inputs of lexer_bench into directory $1 (default .):
+# dense.opl, about 2 MB of one-line functions, and comments.opl, about 3 MB
+# of long comments and string literals.
+dir=${1:-.}
+awk 'BEGIN {
+    for (i = 0; i < 20000; ++i)
+        printf "def f%d(a: int, b: int) -> int { let c: int = a * %d + b; if (c > 3) { c = c - 1; } return c; }\n", i, i
+}' > "$dir/dense.opl"
+awk 'BEGIN {
+    text = "the quick brown fox jumps over the lazy dog while the lexer skips it"
+    for (i = 0; i < 10000; ++i) {
+        printf "# %s %s %d\n", text, text, i
+        printf "let s%d: string = \"%s, %s\";\n", i, text, text
+    }
+}' > "$dir/comments.opl"
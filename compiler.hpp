@@ -0,0 +1,601 @@
+#ifndef OPL_COMPILER_HPP
+#define OPL_COMPILER_HPP
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "assembly.hpp"
+#include "flat_ast.hpp"
+#include "interpreter.hpp"
+
+static_assert(STACK_OR - STACK_ADD == OP_COND_OR, "binary opcodes must follow the Operator enum");
+static_assert(REG_OR - REG_ADD == OP_COND_OR, "binary opcodes must follow the Operator enum");
+
+// ======= Bytecode compiler
+// Translates a resolved FlatAST into instructions for the VirtualMachine. The
+// resolver's (depth, slot) pairs become indices into one flat frame per call:
+// functions never see the locals of an enclosing function, so every block
+// scope of a body can live in the same frame, side by side while nested and
+// sharing space once left. Root-level names stay lookups by name with the
+// slot cached in the instruction, as the interpreter caches it in the FlatAST.
+//
+// With `registers` set, arithmetic, conditions and updates of locals whose
+// operands are all locals or literals are emitted in register form: one
+// three-address instruction per operator, reading and writing frame slots.
+// Intermediate results go to temporaries, slots above the innermost scope
+// that live until the end of the statement. Everything else, and any
+// expression involving a call, member, element or global, uses the operand
+// stack as before.
+
+struct FunctionProto {
+    std::string name;
+    int entry;
+    int argc;
+    int frame_size;
+    int max_stack; // deepest the operand stack gets
+};
+
+class CompiledFunction : public Function {
+public:
+    int proto;
+    CompiledFunction(std::string name, int proto) : Function(F_COMPILED, name) {
+        this->proto = proto;
+    }
+};
+
+// Code, constants and functions of the program and of the modules it imports;
+// a module is compiled and appended when it is first imported.
+class Bytecode {
+public:
+    std::vector<int> code;
+    std::vector<Value> constants;
+    std::vector<std::string> names;
+    std::vector<FunctionProto> functions;
+
+    static const int K_NULL = 0, K_TRUE = 1, K_FALSE = 2, K_UNDEFINED = 3, K_ONE = 4;
+
+    Bytecode() {
+        constants = {Value::null(), Value::from_bool(true), Value::from_bool(false), Value::undefined(), Value::from_int(1)};
+    }
+
+    int name(std::string_view text) {
+        std::string key(text);
+        auto found = name_index.find(key);
+        if (found != name_index.end()) return found->second;
+        names.push_back(key);
+        return name_index[key] = (int)names.size() - 1;
+    }
+
+    int constant(Value value) {
+        constants.push_back(value);
+        return (int)constants.size() - 1;
+    }
+
+private:
+    std::unordered_map<std::string, int> name_index;
+};
+
+class Compiler {
+public:
+    explicit Compiler(Bytecode* out, bool registers = false) {
+        this->out = out;
+        this->registers = registers;
+    }
+
+    // Compiles the top-level statements of a program or module as a function
+    // without arguments, followed by every function defined in it.
+    int compile_module(const FlatAST& module, std::string name) {
+        ast = &module;
+        int proto = new_proto(name, 0);
+        begin(proto, {0, false}, 0, 0);
+        body(ast->statements());
+        end(proto);
+        while (!pending.empty()) {
+            Pending job = pending.back();
+            pending.pop_back();
+            compile_function(job);
+        }
+        return proto;
+    }
+
+private:
+    struct Scope {
+        int base;
+        bool function;
+    };
+
+    // Jumps out of the innermost loop, patched once its end is known.
+    struct Jumps {
+        std::vector<int> breaks, continues;
+    };
+
+    struct Pending {
+        int proto;
+        NodeRef body;
+    };
+
+    Bytecode* out;
+    bool registers;
+    const FlatAST* ast;
+    std::vector<Scope> scopes;
+    int top, frame_size, argc;
+    int stack, max_stack;
+    int temps;
+    std::vector<Jumps> jumps;
+    std::vector<Pending> pending;
+
+    inline AST::AKind kind(NodeRef n) const { return ast->kind(n); }
+
+    inline const FlatAST::Operands& at(NodeRef n) const { return ast->at(n); }
+
+    inline int name(int32_t text) { return out->name(ast->text(text)); }
+
+    inline int here() const { return (int)out->code.size(); }
+
+    template<class... Operands>
+    void emit(int opcode, Operands... operands) {
+        int at = here();
+        out->code.push_back(opcode);
+        (out->code.push_back(operands), ...);
+        stack += stack_effect(opcode, &out->code[at + 1]);
+        max_stack = std::max(max_stack, stack);
+    }
+
+    // How many values an instruction leaves on the operand stack minus how many
+    // it takes. Statements leave the stack as they found it, so the depth is the
+    // same at every jump and its target.
+    static int stack_effect(int opcode, const int* operands) {
+        if (opcode >= REG_ADD) return 0; // register forms leave the stack alone
+        switch (opcode) {
+            case STACK_NOT: case STACK_NEG: case STACK_BIT_NOT: case JMP: case LEAVE: case HALT:
+            case MEMBER_GET: case STACK_SWAP: case DEEP_COPY:
+                return 0;
+            case IMPORT_MODULE: case PUSH: case PUSH_STRING: case LOAD: case LOAD_CHECKED: case LOAD_GLOBAL:
+            case NEW_OBJECT: case MAKE_FUNCTION: case STACK_COPY: case STACK_PICK:
+                return 1;
+            case MEMBER_SET: return -2;
+            case ELEMENT_SET: return -3;
+            case CALL: return -operands[0] - 1;
+            case NEW_ARRAY: return 1 - operands[0];
+            case MAKE_CLASS: return -operands[1];
+            default: return -1; // binary operators, POP, STORE, STORE_GLOBAL, DEFINE_GLOBAL, JMP_IF_*, RETURN, ELEMENT_GET
+        }
+    }
+
+    int jump(int opcode) {
+        emit(opcode, -1);
+        return here() - 1;
+    }
+
+    void patch(int at, int target) { out->code[at] = target; }
+
+    void patch(const std::vector<int>& at, int target) {
+        for (int i : at) patch(i, target);
+    }
+
+    int new_proto(std::string name, int args) {
+        out->functions.push_back({std::move(name), -1, args, 0, 0});
+        return (int)out->functions.size() - 1;
+    }
+
+    void begin(int proto, Scope scope, int args, int size) {
+        out->functions[proto].entry = here();
+        scopes = {scope};
+        argc = args;
+        top = frame_size = size;
+        stack = max_stack = temps = 0;
+    }
+
+    void end(int proto) {
+        emit(LEAVE);
+        out->functions[proto].frame_size = frame_size;
+        out->functions[proto].max_stack = max_stack;
+    }
+
+    // The frame starts with [args..., this, callee], where the resolver numbers
+    // 'this' 0 and the arguments from 1; the body's own locals follow.
+    void compile_function(const Pending& job) {
+        int args = out->functions[job.proto].argc;
+        begin(job.proto, {0, true}, args, at(job.body).b + 1);
+        body(ast->list(at(job.body).a));
+        end(job.proto);
+    }
+
+    int local(int depth, int slot) const {
+        const Scope& scope = scopes[scopes.size() - 1 - depth];
+        if (!scope.function) return scope.base + slot;
+        return (slot == 0)? argc : (slot <= argc)? slot - 1 : slot + 1;
+    }
+
+    void enter_scope(int size) {
+        scopes.push_back({top, false});
+        top += size;
+        frame_size = std::max(frame_size, top);
+    }
+
+    void leave_scope(int size) {
+        top -= size;
+        scopes.pop_back();
+    }
+
+    // A break or continue outside a loop ends the statement of the body it is
+    // in, as on the tree, where the completion stops at the statement list.
+    void body(NodeList statements) {
+        for (auto i : statements) {
+            jumps.emplace_back();
+            statement(i);
+            patch(jumps.back().breaks, here());
+            patch(jumps.back().continues, here());
+            jumps.pop_back();
+        }
+    }
+
+    void block(NodeRef n) {
+        enter_scope(at(n).b);
+        for (auto i : ast->list(at(n).a)) statement(i);
+        leave_scope(at(n).b);
+    }
+
+    // Closes the innermost loop: continues go to `next`, breaks and `exit` past the loop.
+    void close_loop(int next, int exit) {
+        Jumps loop = std::move(jumps.back());
+        jumps.pop_back();
+        patch(loop.continues, next);
+        patch(loop.breaks, here());
+        patch(exit, here());
+    }
+
+    void statement(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        temps = 0;
+        switch (kind(n)) {
+            case AST::A_IF: {
+                int skip = jump_unless(op.a);
+                block(op.b);
+                if (op.c == NO_NODE) {
+                    patch(skip, here());
+                    break;
+                }
+                int end = jump(JMP);
+                patch(skip, here());
+                block(op.c);
+                patch(end, here());
+                break;
+            }
+            case AST::A_BLOCK: for (auto i : ast->list(op.a)) statement(i); break;
+            case AST::A_WHILE: {
+                int condition = here();
+                int exit = jump_unless(op.a);
+                jumps.emplace_back();
+                block(op.b);
+                emit(JMP, condition);
+                close_loop(condition, exit);
+                break;
+            }
+            case AST::A_FOR: {
+                enter_scope(1);
+                statement(op.a);
+                int condition = here();
+                int exit = jump_unless(op.b);
+                jumps.emplace_back();
+                block(ast->extra[op.c + 1]);
+                int change = here();
+                statement(ast->extra[op.c]);
+                emit(JMP, condition);
+                close_loop(change, exit);
+                leave_scope(1);
+                break;
+            }
+            case AST::A_RETURN: {
+                if (op.a == NO_NODE) emit(LEAVE);
+                else expr(op.a), emit(RETURN);
+                break;
+            }
+            case AST::A_BREAK: jumps.back().breaks.push_back(jump(JMP)); break;
+            case AST::A_CONTINUE: jumps.back().continues.push_back(jump(JMP)); break;
+            case AST::A_CLASS: make_class(n); break;
+            case AST::A_IMPORT: emit(IMPORT_MODULE, name(op.a)), emit(POP); break;
+            case AST::A_FUNC_DEFINE: function_value(n), emit(DEFINE_GLOBAL, name(op.a)); break;
+            case AST::A_VAR_DEF: {
+                if (op.c >= 0 && op.b != NO_NODE && registers && simple(op.b)) {
+                    into(local(0, op.c), op.b, REG_MOVE);
+                    break;
+                }
+                if (op.b != NO_NODE) expr(op.b);
+                else emit(PUSH, Bytecode::K_NULL);
+                if (op.c < 0) emit(DEFINE_GLOBAL, name(op.a));
+                else emit(STORE, local(0, op.c));
+                break;
+            }
+            case AST::A_SELF_OPERA: assign(n); break;
+            case AST::A_SELF_INC: step(op.a, STACK_ADD); break;
+            case AST::A_SELF_DEC: step(op.a, STACK_SUB); break;
+            case AST::A_ARRAY: case AST::A_STRING: case AST::A_INT: case AST::A_FLO: case AST::A_TRUE:
+            case AST::A_FALSE: case AST::A_BIN_OP: case AST::A_LAMBDA: case AST::A_BIT_NOT:
+            case AST::A_MEMBER_ACCESS: case AST::A_ID: case AST::A_ELEMENT_GET: case AST::A_CALL:
+            case AST::A_NOT: case AST::A_NEG: case AST::A_MEM_MALLOC: case AST::A_NULL:
+                expr(n), emit(POP);
+                break;
+            default:
+                printf("Operator '%d' not suppose\n", kind(n));
+                exit(-1);
+        }
+    }
+
+    void expr(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        if (registers && computed(n) && simple(n)) {
+            int t = temp();
+            compute(t, n);
+            emit(LOAD, t);
+            return;
+        }
+        switch (kind(n)) {
+            case AST::A_BIN_OP: expr(op.b), expr(op.c), emit(STACK_ADD + op.a); break;
+            case AST::A_STRING: emit(PUSH_STRING, name(op.a)); break;
+            case AST::A_INT: emit(PUSH, out->constant(Value::from_int(ast->ints[op.a]))); break;
+            case AST::A_FLO: emit(PUSH, out->constant(Value::from_float(ast->floats[op.a]))); break;
+            case AST::A_TRUE: emit(PUSH, Bytecode::K_TRUE); break;
+            case AST::A_FALSE: emit(PUSH, Bytecode::K_FALSE); break;
+            case AST::A_NULL: emit(PUSH, Bytecode::K_NULL); break;
+            case AST::A_LAMBDA: function_value(n); break;
+            case AST::A_ID: load(n); break;
+            case AST::A_MEMBER_ACCESS: expr(op.a), emit(MEMBER_GET, name(op.b)); break;
+            case AST::A_CALL: call(n); break;
+            case AST::A_NOT: expr(op.a), emit(STACK_NOT); break;
+            case AST::A_NEG: expr(op.a), emit(STACK_NEG); break;
+            case AST::A_BIT_NOT: expr(op.a), emit(STACK_BIT_NOT); break;
+            case AST::A_ELEMENT_GET: expr(op.a), expr(op.b), emit(ELEMENT_GET); break;
+            case AST::A_MEM_MALLOC: construct(n); break;
+            case AST::A_ARRAY: {
+                NodeList elements = ast->list(op.a);
+                for (auto i : elements) expr(i);
+                emit(NEW_ARRAY, elements.size());
+                break;
+            }
+            default:
+                std::cout << "Unknown tree: " << kind(n) << "\n";
+                exit(-1);
+        }
+    }
+
+    int jump_unless(NodeRef condition) {
+        if (!registers || !simple(condition)) {
+            expr(condition);
+            return jump(JMP_IF_FALSE);
+        }
+        emit(REG_JMP_IF_FALSE, operand(condition), -1);
+        return here() - 1;
+    }
+
+    // The slot of a local that can be read without a check, or -1.
+    int readable(NodeRef n) const {
+        const FlatAST::Operands& op = at(n);
+        if (kind(n) != AST::A_ID || op.b == IdNode::GLOBAL) return -1;
+        if (op.c == 0 && scopes[scopes.size() - 1 - op.b].function) return -1;
+        return local(op.b, op.c);
+    }
+
+    // The constant a literal pushes, or -1.
+    int literal(NodeRef n) {
+        switch (kind(n)) {
+            case AST::A_INT: return out->constant(Value::from_int(ast->ints[at(n).a]));
+            case AST::A_FLO: return out->constant(Value::from_float(ast->floats[at(n).a]));
+            case AST::A_TRUE: return Bytecode::K_TRUE;
+            case AST::A_FALSE: return Bytecode::K_FALSE;
+            case AST::A_NULL: return Bytecode::K_NULL;
+            default: return -1;
+        }
+    }
+
+    static bool computed(AST::AKind k) {
+        return k == AST::A_BIN_OP || k == AST::A_NOT || k == AST::A_NEG || k == AST::A_BIT_NOT;
+    }
+
+    bool computed(NodeRef n) const { return computed(kind(n)); }
+
+    // Whether `n` only combines locals and literals, so it can be evaluated in register form.
+    bool simple(NodeRef n) const {
+        AST::AKind k = kind(n);
+        if (k == AST::A_INT || k == AST::A_FLO || k == AST::A_TRUE || k == AST::A_FALSE || k == AST::A_NULL) return true;
+        if (k == AST::A_ID) return readable(n) >= 0;
+        if (k == AST::A_BIN_OP) return simple(at(n).b) && simple(at(n).c);
+        return computed(k) && simple(at(n).a);
+    }
+
+    int temp() {
+        int slot = top + temps++;
+        frame_size = std::max(frame_size, slot + 1);
+        return slot;
+    }
+
+    // A register operand holding the value of the simple expression `n`.
+    int operand(NodeRef n) {
+        int slot = readable(n);
+        if (slot >= 0) return slot;
+        if (!computed(n)) return ~literal(n);
+        slot = temp();
+        compute(slot, n);
+        return slot;
+    }
+
+    void compute(int dst, NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        switch (kind(n)) {
+            case AST::A_BIN_OP: {
+                int l = operand(op.b);
+                emit(REG_ADD + op.a, dst, l, operand(op.c));
+                break;
+            }
+            case AST::A_NOT: emit(REG_NOT, dst, operand(op.a)); break;
+            case AST::A_NEG: emit(REG_NEG, dst, operand(op.a)); break;
+            default: emit(REG_BIT_NOT, dst, operand(op.a)); break;
+        }
+    }
+
+    // Stores the simple expression `n` in slot `dst`. Operators always make a
+    // new value, so their result is written there directly; a local or literal
+    // is moved with `move` (REG_MOVE or REG_COPY).
+    void into(int dst, NodeRef n, int move) {
+        if (computed(n)) compute(dst, n);
+        else emit(move, dst, operand(n));
+    }
+
+    // 'this' is unset in a function that was not called as a method.
+    void load(NodeRef id) {
+        const FlatAST::Operands& op = at(id);
+        if (op.b == IdNode::GLOBAL) emit(LOAD_GLOBAL, name(op.a), -1);
+        else if (op.c == 0 && scopes[scopes.size() - 1 - op.b].function) emit(LOAD_CHECKED, local(op.b, op.c), name(op.a));
+        else emit(LOAD, local(op.b, op.c));
+    }
+
+    void call(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        NodeList args = ast->list(op.b);
+        for (auto i : args) expr(i);
+        NodeRef callee = op.a;
+        int callee_name = -1;
+        if (kind(callee) == AST::A_MEMBER_ACCESS) {
+            callee_name = name(at(callee).b);
+            expr(at(callee).a);
+            emit(STACK_COPY);
+            emit(MEMBER_GET, callee_name);
+        } else {
+            if (kind(callee) == AST::A_ID) callee_name = name(at(callee).a);
+            emit(PUSH, Bytecode::K_UNDEFINED);
+            expr(callee);
+        }
+        emit(CALL, args.size(), callee_name);
+    }
+
+    // The object is created and its constructor checked before the arguments
+    // are evaluated; the constructor then runs with the object as 'this'.
+    void construct(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        int argc = (op.b == NO_NODE)? -1 : ast->list(op.b).size();
+        emit(NEW_OBJECT, name(op.a), -1, argc);
+        if (argc < 0) return;
+        for (auto i : ast->list(op.b)) expr(i);
+        emit(STACK_PICK, argc);
+        emit(STACK_COPY);
+        emit(MEMBER_GET, out->name("constructor"));
+        emit(CALL, argc, out->name(std::string(ast->text(op.a)) + "$constructor"));
+        emit(POP);
+    }
+
+    void function_value(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        bool lambda = kind(n) == AST::A_LAMBDA;
+        NodeList params = ast->list((lambda)? op.a : op.b);
+        std::string fn_name = (lambda)? "<UserDefineSubProgram>" : std::string(ast->text(op.a));
+        int proto = new_proto(fn_name, params.size());
+        pending.push_back({proto, (lambda)? op.b : op.c});
+        emit(MAKE_FUNCTION, proto);
+    }
+
+    void make_class(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        NodeList members = ast->list(op.b);
+        std::vector<int> member_names;
+        for (int i = 0; i < members.size(); i += 2) {
+            NodeRef member = members[i + 1];
+            member_names.push_back(name(members[i]));
+            if (kind(member) != AST::A_VAR_DEF) function_value(member);
+            else if (at(member).b != NO_NODE) expr(at(member).b);
+            else emit(PUSH, Bytecode::K_NULL);
+        }
+        emit(MAKE_CLASS, name(op.a), (int)member_names.size());
+        for (int i : member_names) out->code.push_back(i);
+    }
+
+    // `target = value` stores a copy of the value; `target op= value` reads the
+    // target after evaluating the value, like the tree does.
+    void assign(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        NodeRef target = op.a;
+        bool plain = op.c == OP_COUNT;
+        const FlatAST::Operands& t = at(target);
+        switch (kind(target)) {
+            case AST::A_ID: {
+                if (t.b == IdNode::GLOBAL) {
+                    int global = name(t.a);
+                    expr(op.b);
+                    if (plain) emit(DEEP_COPY);
+                    else emit(LOAD_GLOBAL, global, -1), emit(STACK_SWAP), emit(STACK_ADD + op.c);
+                    emit(STORE_GLOBAL, global, -1);
+                } else if (registers && simple(op.b) && (plain || readable(target) >= 0)) {
+                    int dst = local(t.b, t.c);
+                    if (plain) into(dst, op.b, REG_COPY);
+                    else emit(REG_ADD + op.c, dst, dst, operand(op.b));
+                } else {
+                    if (!plain) load(target);
+                    expr(op.b);
+                    emit((plain)? DEEP_COPY : STACK_ADD + op.c);
+                    emit(STORE, local(t.b, t.c));
+                }
+                break;
+            }
+            case AST::A_MEMBER_ACCESS: {
+                int member = name(t.b);
+                expr(t.a);
+                expr(op.b);
+                if (plain) emit(DEEP_COPY);
+                else emit(STACK_PICK, 1), emit(MEMBER_GET, member), emit(STACK_SWAP), emit(STACK_ADD + op.c);
+                emit(MEMBER_SET, member);
+                break;
+            }
+            case AST::A_ELEMENT_GET: {
+                expr(t.a);
+                expr(t.b);
+                expr(op.b);
+                if (plain) emit(DEEP_COPY);
+                else emit(STACK_PICK, 2), emit(STACK_PICK, 2), emit(ELEMENT_GET), emit(STACK_SWAP), emit(STACK_ADD + op.c);
+                emit(ELEMENT_SET);
+                break;
+            }
+            default:
+                std::cout << "Expression cannot be used as lvalue\n";
+                exit(-1);
+        }
+    }
+
+    // ++target / --target as a statement; the value is never used.
+    void step(NodeRef target, int opcode) {
+        const FlatAST::Operands& t = at(target);
+        switch (kind(target)) {
+            case AST::A_ID: {
+                if (registers && readable(target) >= 0) {
+                    int slot = readable(target);
+                    emit(opcode - STACK_ADD + REG_ADD, slot, slot, ~Bytecode::K_ONE);
+                    break;
+                }
+                load(target);
+                emit(PUSH, Bytecode::K_ONE), emit(opcode);
+                if (t.b == IdNode::GLOBAL) emit(STORE_GLOBAL, name(t.a), -1);
+                else emit(STORE, local(t.b, t.c));
+                break;
+            }
+            case AST::A_MEMBER_ACCESS: {
+                int member = name(t.b);
+                expr(t.a);
+                emit(STACK_COPY), emit(MEMBER_GET, member);
+                emit(PUSH, Bytecode::K_ONE), emit(opcode);
+                emit(MEMBER_SET, member);
+                break;
+            }
+            case AST::A_ELEMENT_GET: {
+                expr(t.a);
+                expr(t.b);
+                emit(STACK_PICK, 1), emit(STACK_PICK, 1), emit(ELEMENT_GET);
+                emit(PUSH, Bytecode::K_ONE), emit(opcode);
+                emit(ELEMENT_SET);
+                break;
+            }
+            default:
+                std::cout << "Expression cannot be used as lvalue\n";
+                exit(-1);
+        }
+    }
+};
+
+#endif
@@ -1,112 +1,451 @@
 #ifndef EXECUTE
 #define EXECUTE
 #include <vector>
+#include <string>
+#include <unordered_map>
 #include "assembly.hpp"
-#include <stack>
-#include <cmath>
+#include "compiler.hpp"
+#include "interpreter.hpp"
 
-struct RunningFrame {
-    int pc;
-    std::stack<long long> sta;
-    std::vector<long long> loc;
-    RunningFrame(int pc) {
-        this->pc = pc;
-    }
-};
+// ======= Virtual machine
+// Runs the Compiler's bytecode on the interpreter's runtime: the same Values,
+// heap objects, operator table, builtins and root Context. All frames share
+// one contiguous value stack: a call's [args..., this, callee] become the
+// first locals of the callee's frame where they lie, the rest of its locals
+// follow, and its operand stack, sized by the compiler, sits on top. The heap
+// is collected at calls and backward jumps, where every live Value is on the
+// stack or in the root.
+//
+// execute() keeps the running frame's pc, stack pointer and locals in local
+// variables and writes them back to the frame only around calls, imports and
+// collections. With OPL_COMPUTED_GOTO on GCC or Clang every instruction jumps
+// straight to the next one's handler through a table of label addresses;
+// otherwise it is a switch in a loop.
+//
+// Arithmetic, comparisons and indexing quicken: a generic instruction whose
+// operands are small ints (and an array) rewrites its opcode to a form that
+// computes that case directly instead of going through the operator table.
+// The quickened form checks the same condition and, when it no longer holds,
+// turns the instruction back into the generic one and runs that instead.
 
-struct OPL_Object {
-    std::vector<long long> loc_mem;
-};
+#if defined(OPL_COMPUTED_GOTO) && (defined(__GNUC__) || defined(__clang__))
+#define OPL_THREADED_DISPATCH
+#endif
+
+// Positions are stack indices, so the stack can grow under suspended frames.
+// The form a generic binary instruction takes after seeing two small ints, or -1.
+static constexpr int int_int_form(int opcode) {
+    switch (opcode) {
+        case STACK_ADD: return ADD_INT_INT;
+        case STACK_SUB: return SUB_INT_INT;
+        case STACK_MUL: return MUL_INT_INT;
+        case STACK_MOD: return MOD_INT_INT;
+        case STACK_EQ: return EQ_INT_INT;
+        case STACK_NOT_EQ: return NOT_EQ_INT_INT;
+        case STACK_LESS: return LESS_INT_INT;
+        case STACK_BIG: return BIG_INT_INT;
+        case STACK_LESS_OR_EQ: return LESS_OR_EQ_INT_INT;
+        case STACK_BIG_OR_EQ: return BIG_OR_EQ_INT_INT;
+        case REG_ADD: return REG_ADD_INT_INT;
+        case REG_SUB: return REG_SUB_INT_INT;
+        case REG_MUL: return REG_MUL_INT_INT;
+        case REG_MOD: return REG_MOD_INT_INT;
+        case REG_EQ: return REG_EQ_INT_INT;
+        case REG_NOT_EQ: return REG_NOT_EQ_INT_INT;
+        case REG_LESS: return REG_LESS_INT_INT;
+        case REG_BIG: return REG_BIG_INT_INT;
+        case REG_LESS_OR_EQ: return REG_LESS_OR_EQ_INT_INT;
+        case REG_BIG_OR_EQ: return REG_BIG_OR_EQ_INT_INT;
+        default: return -1;
+    }
+}
 
-OPL_Object* copy_object(OPL_Object* obj) {
-    std::vector<long long> loc_mem;
-    for (auto i : obj->loc_mem) loc_mem.push_back(i);
-    auto a = new OPL_Object;
-    a->loc_mem = loc_mem;
-    return a;
+static inline bool is_array(Value v) {
+    return v.is_object() && v.object()->kind == Value::V_ARRAY;
 }
 
+struct RunningFrame {
+    int pc;
+    int name; // what the function was called as, for error messages
+    int base; // first local
+    int sp; // one past the top of the operand stack
+};
+
 class VirtualMachine {
 public:
-    VirtualMachine(std::vector<int> opc) {
-        this->opc = opc;
-        create_task_by_address(opc[0]); // opc[0] is main function address
+    VirtualMachine(FlatAST* program, ModuleManager* mg, bool registers = false) : compiler(&bytecode, registers) {
+        this->mg = mg;
+        stack.resize(INITIAL_STACK);
+        root = new Context("<Program>");
+        setup_build_in_functions(root);
+        mg->regist("<Program>", program);
+        mg->preload(*program);
+        int main = compiler.compile_module(*program, "<Program>");
+        create_task_by_address(main, bytecode.name("<Program>"));
     }
 
-    int execute() {
-        int i = get();
-        switch (i) {
-            case IMPORT_MODULE: { break; }
-
-            case STACK_ADD: { long long a = pop(), b = pop(); push(a + b); break; }
-            case STACK_SUB: { long long a = pop(), b = pop(); push(a - b); break; }
-            case STACK_DIV: { long long a = pop(), b = pop(); push(a * b); break; }
-            case STACK_MUL: { long long a = pop(), b = pop(); push(a / b); break; }
-            case STACK_MOD: { long long a = pop(), b = pop(); push(a % b); break; }
-            case STACK_LEFT: { long long a = pop(), b = pop(); push(a << b); break; }
-            case STACK_RIGHT: { long long a = pop(), b = pop(); push(a >> b); break; }
-            case STACK_POW: { long long a = pop(), b = pop(); push(pow(a, b)); break; }
-
-            case POP: { pop(); break; }
-            case PUSH: { push(get()); break; }
-            case LOAD: { load(); break; }
-            case STORE: {  break; }
-            case JMP: { break; }
-            case JMP_IF_TRUE: { break; }
-            case JMP_IF_FALSE: { break; }
-            case CALL: { break; }
-            case RETURN: { break; }
-            case LEAVE: { break; }
-            case HALT: { exit(pop()); break; }
-            case NEW_OBJECT: { push(new_object(pop())); break; }
-            case MEMBER_SET: {
-
-                break;
+    void execute() {
+        RunningFrame* f;
+        int* code = bytecode.code.data();
+        Value* constants = bytecode.constants.data();
+        int* pc;
+        Value* sp;
+        Value* loc;
+
+#define SAVE_FRAME() (f->pc = (int)(pc - code), f->sp = (int)(sp - stack.data()))
+#define LOAD_FRAME() (f = &funcs[depth - 1], pc = code + f->pc, sp = stack.data() + f->sp, loc = stack.data() + f->base)
+#ifdef OPL_THREADED_DISPATCH
+#define OPL_OPCODE_LABEL(op) &&L_##op,
+        static void* const labels[OPCODE_COUNT] = {OPL_OPCODES(OPL_OPCODE_LABEL)};
+#undef OPL_OPCODE_LABEL
+#define TARGET(op) L_##op:
+#define DISPATCH() goto *labels[*pc++]
+#else
+#define TARGET(op) case op:
+#define DISPATCH() continue
+#endif
+#define QUICKEN(form) (pc[-1] = (form))
+#define DEOPTIMIZE(generic) { \
+            pc[-1] = generic; \
+            --pc; \
+            DISPATCH(); \
+        }
+#define BINARY(op) TARGET(op) { \
+            Value r = *--sp; \
+            if (int_int_form(op) >= 0 && sp[-1].is_small_int() && r.is_small_int()) QUICKEN(int_int_form(op)); \
+            sp[-1] = binary_operation((Operator)(op - STACK_ADD), sp[-1], r); \
+            DISPATCH(); \
+        }
+#define REGISTER(x) (((x) >= 0)? loc[x] : constants[~(x)])
+#define REG_BINARY(op) TARGET(op) { \
+            Value l = REGISTER(pc[1]), r = REGISTER(pc[2]); \
+            if (int_int_form(op) >= 0 && l.is_small_int() && r.is_small_int()) QUICKEN(int_int_form(op)); \
+            loc[pc[0]] = binary_operation((Operator)(op - REG_ADD), l, r); \
+            pc += 3; \
+            DISPATCH(); \
+        }
+#define INT_INT(form, generic, kernel) TARGET(form) { \
+            if (!sp[-2].is_small_int() || !sp[-1].is_small_int()) DEOPTIMIZE(generic); \
+            --sp; \
+            sp[-1] = kernel(sp[-1], sp[0]); \
+            DISPATCH(); \
+        }
+#define REG_INT_INT(form, generic, kernel) TARGET(form) { \
+            Value l = REGISTER(pc[1]), r = REGISTER(pc[2]); \
+            if (!l.is_small_int() || !r.is_small_int()) DEOPTIMIZE(generic); \
+            loc[pc[0]] = kernel(l, r); \
+            pc += 3; \
+            DISPATCH(); \
+        }
+#define LEAVE_FRAME(value) { \
+            Value result = value; \
+            if (--depth == 0) return; \
+            LOAD_FRAME(); \
+            *sp++ = result; \
+            DISPATCH(); \
+        }
+
+        LOAD_FRAME();
+#ifdef OPL_THREADED_DISPATCH
+        DISPATCH();
+#else
+        while (true) switch (*pc++) {
+#endif
+        TARGET(IMPORT_MODULE) {
+            pc++;
+            SAVE_FRAME();
+            import_module(pc[-1]);
+            code = bytecode.code.data();
+            constants = bytecode.constants.data();
+            LOAD_FRAME();
+            DISPATCH();
+        }
+
+        BINARY(STACK_ADD) BINARY(STACK_SUB) BINARY(STACK_MUL) BINARY(STACK_DIV) BINARY(STACK_MOD) BINARY(STACK_POW)
+        BINARY(STACK_BIT_AND) BINARY(STACK_BIT_OR) BINARY(STACK_BIT_XOR) BINARY(STACK_LEFT) BINARY(STACK_RIGHT)
+        BINARY(STACK_EQ) BINARY(STACK_NOT_EQ) BINARY(STACK_LESS) BINARY(STACK_BIG) BINARY(STACK_LESS_OR_EQ)
+        BINARY(STACK_BIG_OR_EQ) BINARY(STACK_AND) BINARY(STACK_OR)
+        TARGET(STACK_NOT) { sp[-1] = op_cond_not(sp[-1]); DISPATCH(); }
+        TARGET(STACK_NEG) { sp[-1] = op_neg(sp[-1]); DISPATCH(); }
+        TARGET(STACK_BIT_NOT) { sp[-1] = op_bit_not(sp[-1]); DISPATCH(); }
+
+        TARGET(POP) { --sp; DISPATCH(); }
+        TARGET(PUSH) { *sp++ = bytecode.constants[*pc++]; DISPATCH(); }
+        TARGET(PUSH_STRING) { *sp++ = new String(bytecode.names[*pc++]); DISPATCH(); }
+        TARGET(LOAD) { *sp++ = loc[*pc++]; DISPATCH(); }
+        TARGET(LOAD_CHECKED) {
+            Value v = loc[pc[0]];
+            if (v.is_undefined()) {
+                std::cout << "Name '" << bytecode.names[pc[1]] << "' is not define in scope '" << bytecode.names[f->name] << "'\n";
+                exit(-1);
             }
-            case STACK_COPY: {
-                long long tmp = funcs[funcs.size() - 1].sta.top();
-                push(tmp);
-                break;
+            *sp++ = v;
+            pc += 2;
+            DISPATCH();
+        }
+        TARGET(STORE) { loc[*pc++] = *--sp; DISPATCH(); }
+        TARGET(LOAD_GLOBAL) { *sp++ = global(pc); pc += 2; DISPATCH(); }
+        TARGET(STORE_GLOBAL) { global(pc) = *--sp; pc += 2; DISPATCH(); }
+        TARGET(DEFINE_GLOBAL) { root->add(bytecode.names[*pc++], *--sp); DISPATCH(); }
+
+        TARGET(JMP) {
+            int* target = code + *pc;
+            if (target < pc && heap.should_collect()) {
+                SAVE_FRAME();
+                collect_garbage();
+            }
+            pc = target;
+            DISPATCH();
+        }
+        TARGET(JMP_IF_TRUE) { pc = ((*--sp).as_bool())? code + *pc : pc + 1; DISPATCH(); }
+        TARGET(JMP_IF_FALSE) { pc = ((*--sp).as_bool())? pc + 1 : code + *pc; DISPATCH(); }
+        TARGET(CALL) {
+            int argc = pc[0], name = pc[1];
+            pc += 2;
+            Value callee = sp[-1];
+            expect(callee, Value::V_FUNC);
+            Function* fn = (Function*)callee.object();
+            Value* args = sp - argc - 2;
+            if (fn->fun_kind == Function::F_BUILD_IN) {
+                Value result = ((BuildInFunctions*)fn)->__call__({args, argc});
+                sp = args;
+                *sp++ = result;
+                DISPATCH();
             }
-            case DEEP_COPY: { push((long long)copy_object((OPL_Object*)pop())); break; }
+            int index = ((CompiledFunction*)fn)->proto;
+            const FunctionProto& proto = bytecode.functions[index];
+            if (name < 0) name = bytecode.name(fn->name);
+            if (argc != proto.argc) {
+                std::cout << "Function '" << bytecode.names[name] << "' need " << proto.argc << " values\n";
+                exit(-1);
+            }
+            SAVE_FRAME();
+            if (heap.should_collect()) collect_garbage();
+            f->sp = (int)(args - stack.data());
+            f = push_frame(index, name, f->sp, argc + 2);
+            pc = code + f->pc;
+            loc = stack.data() + f->base;
+            sp = stack.data() + f->sp;
+            DISPATCH();
+        }
+        TARGET(RETURN) LEAVE_FRAME(sp[-1])
+        TARGET(LEAVE) LEAVE_FRAME(Value::null())
+        TARGET(HALT) { depth = 0; return; }
+
+        TARGET(NEW_OBJECT) { *sp++ = new_object(pc); pc += 3; DISPATCH(); }
+        TARGET(NEW_ARRAY) {
+            int count = *pc++;
+            std::vector<Value> elements(sp - count, sp);
+            sp -= count;
+            *sp++ = new Array(elements);
+            DISPATCH();
+        }
+        TARGET(MAKE_FUNCTION) {
+            int proto = *pc++;
+            *sp++ = new CompiledFunction(bytecode.functions[proto].name, proto);
+            DISPATCH();
+        }
+        TARGET(MAKE_CLASS) {
+            const std::string& name = bytecode.names[pc[0]];
+            int count = pc[1];
+            std::unordered_map<std::string, Value> members;
+            sp -= count;
+            for (int i = 0; i < count; ++i) members[bytecode.names[pc[2 + i]]] = sp[i];
+            root->add(name, new BasicObject(name, members));
+            pc += 2 + count;
+            DISPATCH();
+        }
+        TARGET(MEMBER_GET) { sp[-1] = member_object(sp[-1])->get(bytecode.names[*pc++]); DISPATCH(); }
+        TARGET(MEMBER_SET) {
+            sp -= 2;
+            member_object(sp[0])->set(bytecode.names[*pc++], sp[1]);
+            DISPATCH();
+        }
+        TARGET(ELEMENT_GET) {
+            Value position = *--sp;
+            if (position.is_small_int() && is_array(sp[-1])) QUICKEN(ELEMENT_GET_ARRAY_INT);
+            sp[-1] = heap_operand(sp[-1], "[]")->element_get(position);
+            DISPATCH();
+        }
+        TARGET(ELEMENT_SET) {
+            sp -= 3;
+            element_set(sp[0], sp[1], sp[2]);
+            DISPATCH();
+        }
+        TARGET(STACK_COPY) { *sp = sp[-1]; ++sp; DISPATCH(); }
+        TARGET(STACK_PICK) { *sp = sp[-1 - *pc++]; ++sp; DISPATCH(); }
+        TARGET(STACK_SWAP) { std::swap(sp[-1], sp[-2]); DISPATCH(); }
+        TARGET(DEEP_COPY) { sp[-1] = sp[-1].copy(); DISPATCH(); }
+
+        REG_BINARY(REG_ADD) REG_BINARY(REG_SUB) REG_BINARY(REG_MUL) REG_BINARY(REG_DIV) REG_BINARY(REG_MOD)
+        REG_BINARY(REG_POW) REG_BINARY(REG_BIT_AND) REG_BINARY(REG_BIT_OR) REG_BINARY(REG_BIT_XOR) REG_BINARY(REG_LEFT)
+        REG_BINARY(REG_RIGHT) REG_BINARY(REG_EQ) REG_BINARY(REG_NOT_EQ) REG_BINARY(REG_LESS) REG_BINARY(REG_BIG)
+        REG_BINARY(REG_LESS_OR_EQ) REG_BINARY(REG_BIG_OR_EQ) REG_BINARY(REG_AND) REG_BINARY(REG_OR)
+        TARGET(REG_NOT) { loc[pc[0]] = op_cond_not(REGISTER(pc[1])); pc += 2; DISPATCH(); }
+        TARGET(REG_NEG) { loc[pc[0]] = op_neg(REGISTER(pc[1])); pc += 2; DISPATCH(); }
+        TARGET(REG_BIT_NOT) { loc[pc[0]] = op_bit_not(REGISTER(pc[1])); pc += 2; DISPATCH(); }
+        TARGET(REG_MOVE) { loc[pc[0]] = REGISTER(pc[1]); pc += 2; DISPATCH(); }
+        TARGET(REG_COPY) { loc[pc[0]] = REGISTER(pc[1]).copy(); pc += 2; DISPATCH(); }
+        TARGET(REG_JMP_IF_FALSE) { pc = (REGISTER(pc[0]).as_bool())? pc + 2 : code + pc[1]; DISPATCH(); }
+
+        INT_INT(ADD_INT_INT, STACK_ADD, exact_int_int<AddOp>)
+        INT_INT(SUB_INT_INT, STACK_SUB, exact_int_int<SubOp>)
+        INT_INT(MUL_INT_INT, STACK_MUL, exact_int_int<MulOp>)
+        INT_INT(MOD_INT_INT, STACK_MOD, int_int<ModOp>)
+        INT_INT(EQ_INT_INT, STACK_EQ, cmp_int_int<EqOp>)
+        INT_INT(NOT_EQ_INT_INT, STACK_NOT_EQ, cmp_int_int<NotEqOp>)
+        INT_INT(LESS_INT_INT, STACK_LESS, cmp_int_int<LessOp>)
+        INT_INT(BIG_INT_INT, STACK_BIG, cmp_int_int<BigOp>)
+        INT_INT(LESS_OR_EQ_INT_INT, STACK_LESS_OR_EQ, cmp_int_int<LessOrEqOp>)
+        INT_INT(BIG_OR_EQ_INT_INT, STACK_BIG_OR_EQ, cmp_int_int<BigOrEqOp>)
+        REG_INT_INT(REG_ADD_INT_INT, REG_ADD, exact_int_int<AddOp>)
+        REG_INT_INT(REG_SUB_INT_INT, REG_SUB, exact_int_int<SubOp>)
+        REG_INT_INT(REG_MUL_INT_INT, REG_MUL, exact_int_int<MulOp>)
+        REG_INT_INT(REG_MOD_INT_INT, REG_MOD, int_int<ModOp>)
+        REG_INT_INT(REG_EQ_INT_INT, REG_EQ, cmp_int_int<EqOp>)
+        REG_INT_INT(REG_NOT_EQ_INT_INT, REG_NOT_EQ, cmp_int_int<NotEqOp>)
+        REG_INT_INT(REG_LESS_INT_INT, REG_LESS, cmp_int_int<LessOp>)
+        REG_INT_INT(REG_BIG_INT_INT, REG_BIG, cmp_int_int<BigOp>)
+        REG_INT_INT(REG_LESS_OR_EQ_INT_INT, REG_LESS_OR_EQ, cmp_int_int<LessOrEqOp>)
+        REG_INT_INT(REG_BIG_OR_EQ_INT_INT, REG_BIG_OR_EQ, cmp_int_int<BigOrEqOp>)
+        TARGET(ELEMENT_GET_ARRAY_INT) {
+            if (!sp[-1].is_small_int() || !is_array(sp[-2])) DEOPTIMIZE(ELEMENT_GET);
+            // Out of range goes back to the generic form, which reports it.
+            auto& elements = ((Array*)sp[-2].object())->elements;
+            if ((unsigned long long)sp[-1].as_int() >= elements.size()) DEOPTIMIZE(ELEMENT_GET);
+            --sp;
+            sp[-1] = elements[sp[0].as_int()];
+            DISPATCH();
+        }
+#ifndef OPL_THREADED_DISPATCH
             default: {
-                printf("Unknown operator code %d\n", i);
+                printf("Unknown operator code %d\n", pc[-1]);
                 exit(-1);
             }
         }
+#endif
+#undef SAVE_FRAME
+#undef LOAD_FRAME
+#undef TARGET
+#undef DISPATCH
+#undef BINARY
+#undef REGISTER
+#undef REG_BINARY
+#undef QUICKEN
+#undef DEOPTIMIZE
+#undef INT_INT
+#undef REG_INT_INT
+#undef LEAVE_FRAME
     }
 
 private:
-    std::vector<int> opc;
+    Bytecode bytecode;
+    Compiler compiler;
+    ModuleManager* mg;
+    Context* root;
     std::vector<RunningFrame> funcs;
+    size_t depth = 0;
+    std::vector<Value> stack;
+
+    static const size_t INITIAL_STACK = 1 << 16;
 
-    int get() {
-        return opc[funcs[funcs.size() - 1].pc++];
+    // A frame for `proto` whose locals start at stack[base]. The first `given`
+    // are already there (a call's arguments, this and callee); the others
+    // start unset. The stack doubles when the frame does not fit.
+    RunningFrame* push_frame(int proto, int name, int base, int given) {
+        const FunctionProto& p = bytecode.functions[proto];
+        size_t need = (size_t)base + p.frame_size + p.max_stack;
+        if (need > stack.size()) stack.resize(std::max(need, stack.size() * 2));
+        std::fill(stack.begin() + base + given, stack.begin() + base + p.frame_size, Value::undefined());
+        if (depth == funcs.size()) funcs.emplace_back();
+        RunningFrame* f = &funcs[depth++];
+        f->pc = p.entry;
+        f->name = name;
+        f->base = base;
+        f->sp = base + p.frame_size;
+        return f;
     }
 
-    long long pop() {
-        long long tmp = funcs[funcs.size() - 1].sta.top();
-        funcs[funcs.size() - 1].sta.pop();
-        return tmp;
+    void create_task_by_address(int proto, int name) {
+        push_frame(proto, name, (depth == 0)? 0 : funcs[depth - 1].sp, 0);
     }
 
-    void load() {
-        push(funcs[funcs.size() - 1].loc[pop()]);
+    // The root slot named by operands[0], cached in operands[1].
+    Value& global(int* operands) {
+        int& cache = operands[1];
+        if (cache < 0) {
+            const std::string& name = bytecode.names[operands[0]];
+            cache = root->find(name);
+            if (cache < 0) root->not_defined(name);
+        }
+        return root->slots[cache];
     }
 
-    void push(long long value) {
-        funcs[funcs.size() - 1].sta.push(value);
+    // operands: class name, cached root slot, constructor argument count or -1.
+    Value new_object(int* operands) {
+        const std::string& cname = bytecode.names[operands[0]];
+        Value prototype = global(operands);
+        if (prototype.kind() != Value::V_OBJECT) {
+            std::cout << "Name '" << cname << "' is not a class\n";
+            exit(-1);
+        }
+        auto obj = (BasicObject*)prototype.copy().object();
+        auto constructor_val = obj->get_constructor();
+        int argc = operands[2];
+        if (argc < 0) return obj;
+        if (constructor_val.kind() != Value::V_FUNC || ((Function*)constructor_val.object())->fun_kind != Function::F_COMPILED) {
+            std::cout << "Constructor is not a function\n";
+            exit(-1);
+        }
+        const FunctionProto& constructor = bytecode.functions[((CompiledFunction*)constructor_val.object())->proto];
+        if (argc != constructor.argc) {
+            std::cout << cname + "$constructor need " << constructor.argc << " values but find " << argc << "\n";
+            exit(-1);
+        }
+        return obj;
+    }
+
+    static BasicObject* member_object(Value v) {
+        if (v.kind() != Value::V_OBJECT) {
+            std::cout << "Member access on non-object\n";
+            exit(-1);
+        }
+        return (BasicObject*)v.object();
     }
 
-    long long new_object(int size) {
-        OPL_Object *obj = new OPL_Object;
-        obj->loc_mem.resize(size);
-        return (long long) obj;
-    } 
+    static void element_set(Value container, Value position, Value value) {
+        if (position.kind() != Value::V_INT) {
+            std::cout << "Index must be integer\n";
+            exit(-1);
+        }
+        if (container.kind() != Value::V_ARRAY && container.kind() != Value::V_STRING) {
+            std::cout << "Cannot element-get on non-array/string\n";
+            exit(-1);
+        }
+        container.object()->element_set(position, value);
+    }
+
+    // Runs a module's top-level code in a new frame the first time it is
+    // imported; the frame's Null result is what the import pushes.
+    void import_module(int path) {
+        std::string name = bytecode.names[path];
+        if (mg->is_import(name)) {
+            stack[funcs[depth - 1].sp++] = Value::null();
+            return;
+        }
+        mg->regist(name);
+        FlatAST* module = mg->load(name);
+        mg->regist(name, module);
+        int proto = compiler.compile_module(*module, name);
+        create_task_by_address(proto, bytecode.name("<Program>"));
+    }
 
-    void create_task_by_address(int addr) {
-        funcs.push_back(RunningFrame(addr));
+    void collect_garbage() {
+        heap.mark_all(root->slots);
+        heap.mark_all(bytecode.constants);
+        for (int i = 0; i < funcs[depth - 1].sp; ++i) heap.mark(stack[i]);
+        heap.collect();
     }
 };
 
-#endif 
\ No newline at end of file
+#endif
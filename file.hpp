@@ -0,0 +1,98 @@
+#ifndef OPL_FILE_HPP
+#define OPL_FILE_HPP
+#include <string>
+#include <string_view>
+#include <memory>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only contents of a file, memory-mapped when the platform allows it so
+// the lexer and the Read builtin can work on the bytes in place. Files that
+// cannot be mapped (pipes, empty files) are read into an owned buffer instead;
+// a file that cannot be opened reads as empty.
+class MappedFile {
+public:
+    static std::shared_ptr<MappedFile> open(const std::string& path) {
+        return std::shared_ptr<MappedFile>(new MappedFile(path));
+    }
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (!mapped) return;
+#ifdef _WIN32
+        UnmapViewOfFile(mapped);
+#else
+        munmap(mapped, size);
+#endif
+    }
+
+    inline std::string_view view() const {
+        return (mapped)? std::string_view((const char*)mapped, size) : std::string_view(buffer);
+    }
+
+private:
+    void* mapped = nullptr;
+    size_t size = 0;
+    std::string buffer;
+
+    explicit MappedFile(const std::string& path) {
+        if (!map(path)) read(path);
+    }
+
+    bool map(const std::string& path) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return true;
+        LARGE_INTEGER file_size;
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            mapped = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (mapped) size = (size_t)file_size.QuadPart;
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return true;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                mapped = p, size = (size_t)st.st_size;
+                madvise(mapped, size, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+#endif
+        return mapped != nullptr;
+    }
+
+    void read(const std::string& path) {
+        std::ifstream ifs(path, std::ios::binary);
+        std::stringstream ss;
+        ss << ifs.rdbuf();
+        buffer = ss.str();
+    }
+};
+
+#endif
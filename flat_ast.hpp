@@ -0,0 +1,645 @@
+#ifndef OPL_FLAT_AST_HPP
+#define OPL_FLAT_AST_HPP
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "parser.hpp"
+
+// ======= Flat AST
+// The parser's pointer tree flattened into a few contiguous arrays once it has
+// been resolved. A node is an index: its kind lives in `kinds` and its operands
+// in `operands`, three 32-bit fields whose meaning depends on the kind. Child
+// lists live in `extra` as a length followed by the items, and literals, names
+// and spellings in side tables. Nodes are laid out in preorder, so a walk over
+// a subtree moves forward through memory. The tree can be freed once flattened.
+//
+//  kind             a                b                  c
+//  A_IF             condition        then block         else block | NO_NODE
+//  A_BLOCK          statement list   scope size
+//  A_STRING         text
+//  A_INT / A_FLO    ints / floats    spelling
+//  A_WHILE          condition        body
+//  A_FOR            init             condition          extra: [change, body]
+//  A_CLASS          name             member pairs: [name, definition]...
+//  A_RETURN         value | NO_NODE
+//  A_BIN_OP         Operator         left               right
+//  A_NOT / A_NEG /
+//  A_BIT_NOT        operand
+//  A_MEMBER_ACCESS  object           member name
+//  A_ID             name             depth              slot
+//  A_ELEMENT_GET    container        position
+//  A_CALL           callee           argument list
+//  A_ARRAY          element list
+//  A_SELF_INC/DEC   target           pre or npre
+//  A_VAR_DEF        name             init | NO_NODE     slot
+//  A_FUNC_DEFINE    name             parameter list     body block
+//  A_LAMBDA         parameter list   body block
+//  A_SELF_OPERA     target           value              Operator, OP_COUNT for "="
+//  A_MEM_MALLOC     class name       argument list | NO_NODE without "()"    class slot
+//  A_IMPORT         path
+//
+// The slot of a GLOBAL A_ID and of A_MEM_MALLOC is -1 as flattened and is filled
+// in by the interpreter the first time the name is looked up.
+
+using NodeRef = int32_t;
+
+const NodeRef NO_NODE = -1;
+
+struct NodeList {
+    const int32_t* items;
+    int32_t count;
+
+    const int32_t* begin() const { return items; }
+    const int32_t* end() const { return items + count; }
+    int32_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    NodeRef operator[](int32_t i) const { return items[i]; }
+};
+
+class FlatAST {
+public:
+    struct Operands {
+        int32_t a, b, c;
+    };
+
+    struct StringRef {
+        uint32_t offset, size;
+    };
+
+    std::vector<uint8_t> kinds;
+    std::vector<Operands> operands;
+    std::vector<int32_t> extra;
+    std::vector<long long> ints;
+    std::vector<double> floats;
+    std::string pool;                            // bytes of every interned string
+    std::vector<StringRef> strings;              // where each interned string is in pool
+    int32_t program = 0;                         // list of top-level statements
+
+    inline AST::AKind kind(NodeRef n) const { return (AST::AKind)kinds[n]; }
+
+    inline Operands& at(NodeRef n) { return operands[n]; }
+
+    inline const Operands& at(NodeRef n) const { return operands[n]; }
+
+    inline NodeList list(int32_t index) const { return {&extra[index + 1], extra[index]}; }
+
+    inline std::string_view text(int32_t index) const {
+        return std::string_view(pool).substr(strings[index].offset, strings[index].size);
+    }
+
+    inline NodeList statements() const { return list(program); }
+};
+
+// Builds a FlatAST from a resolved tree. Strings are interned, so every use of a
+// name refers to the same side-table entry.
+class Flattener {
+public:
+    explicit Flattener(FlatAST* out) { this->out = out; }
+
+    void program(const std::vector<AST*>& ast) { out->program = list(ast); }
+
+private:
+    FlatAST* out;
+    // Open-addressing table of string indices, compared against the pool.
+    std::vector<int32_t> interned = std::vector<int32_t>(256, -1);
+
+    static uint32_t hash(std::string_view str) {
+        uint32_t h = 2166136261u;
+        for (char c : str) h = (h ^ (uint8_t)c) * 16777619u;
+        return h;
+    }
+
+    int32_t intern(std::string_view str) {
+        size_t mask = interned.size() - 1;
+        for (size_t i = hash(str) & mask; ; i = (i + 1) & mask) {
+            if (interned[i] < 0) break;
+            if (out->text(interned[i]) == str) return interned[i];
+        }
+        int32_t index = (int32_t)out->strings.size();
+        out->strings.push_back({(uint32_t)out->pool.size(), (uint32_t)str.size()});
+        out->pool.append(str);
+        if (out->strings.size() * 2 > interned.size()) rehash(interned.size() * 2);
+        else insert(index);
+        return index;
+    }
+
+    void insert(int32_t index) {
+        size_t mask = interned.size() - 1, i = hash(out->text(index)) & mask;
+        while (interned[i] >= 0) i = (i + 1) & mask;
+        interned[i] = index;
+    }
+
+    void rehash(size_t size) {
+        interned.assign(size, -1);
+        for (int32_t i = 0; i < (int32_t)out->strings.size(); ++i) insert(i);
+    }
+
+    NodeRef add(AST::AKind kind, int32_t a = 0, int32_t b = 0, int32_t c = 0) {
+        out->kinds.push_back((uint8_t)kind);
+        out->operands.push_back({a, b, c});
+        return (NodeRef)out->kinds.size() - 1;
+    }
+
+    // Children are flattened before the list itself is written to `extra`, so
+    // the list stays contiguous even when they add lists of their own. Their refs
+    // wait on `pending`, which nested lists use as a stack.
+    std::vector<int32_t> pending;
+
+    template<class T>
+    int32_t list(const std::vector<T*>& items) {
+        size_t base = pending.size();
+        for (auto i : items) {
+            NodeRef ref = flatten(i);
+            pending.push_back(ref);
+        }
+        return pop_list(base);
+    }
+
+    int32_t pop_list(size_t base) {
+        int32_t index = (int32_t)out->extra.size();
+        out->extra.push_back((int32_t)(pending.size() - base));
+        out->extra.insert(out->extra.end(), pending.begin() + base, pending.end());
+        pending.resize(base);
+        return index;
+    }
+
+    NodeRef optional(AST* a) { return (a)? flatten(a) : NO_NODE; }
+
+    // The node is reserved before its children so the layout is preorder.
+    NodeRef flatten(AST* a) {
+        NodeRef n = add(a->kind);
+        FlatAST::Operands ops{0, 0, 0};
+        switch (a->kind) {
+            case AST::A_IF: {
+                auto node = (IfNode*)a;
+                ops = {flatten(node->condition), flatten(node->if_true), optional(node->if_false)};
+                break;
+            }
+            case AST::A_BLOCK: ops = {list(((Block*)a)->codes), ((Block*)a)->scope_size, 0}; break;
+            case AST::A_STRING: ops.a = intern(((StringNode*)a)->str); break;
+            case AST::A_INT: {
+                out->ints.push_back(((IntegerNode*)a)->value);
+                ops = {(int32_t)out->ints.size() - 1, intern(((IntegerNode*)a)->number), 0};
+                break;
+            }
+            case AST::A_FLO: {
+                out->floats.push_back(((FloatNode*)a)->value);
+                ops = {(int32_t)out->floats.size() - 1, intern(((FloatNode*)a)->number), 0};
+                break;
+            }
+            case AST::A_WHILE: ops = {flatten(((WhileNode*)a)->condition), flatten(((WhileNode*)a)->body), 0}; break;
+            case AST::A_FOR: {
+                auto node = (ForNode*)a;
+                ops.a = flatten(node->init);
+                ops.b = flatten(node->is_continue);
+                NodeRef change = flatten(node->change), body = flatten(node->body);
+                ops.c = (int32_t)out->extra.size();
+                out->extra.push_back(change);
+                out->extra.push_back(body);
+                break;
+            }
+            case AST::A_CLASS: {
+                auto node = (ObjectNode*)a;
+                size_t base = pending.size();
+                for (auto& i : node->members) {
+                    int32_t name = intern(i.first);
+                    NodeRef member = flatten(i.second);
+                    pending.push_back(name), pending.push_back(member);
+                }
+                ops = {intern(node->name), pop_list(base), 0};
+                break;
+            }
+            case AST::A_RETURN: ops.a = optional(((ReturnNode*)a)->value); break;
+            case AST::A_BIN_OP: {
+                auto node = (BinOpNode*)a;
+                ops.a = node->opcode;
+                ops.b = flatten(node->left);
+                ops.c = flatten(node->right);
+                break;
+            }
+            case AST::A_NOT: ops.a = flatten(((NotNode*)a)->expr); break;
+            case AST::A_NEG: ops.a = flatten(((NegNode*)a)->expr); break;
+            case AST::A_BIT_NOT: ops.a = flatten(((BitNotNode*)a)->expr); break;
+            case AST::A_MEMBER_ACCESS: {
+                auto node = (MemberAccessNode*)a;
+                ops = {flatten(node->parent), intern(node->member), 0};
+                break;
+            }
+            case AST::A_ID: ops = {intern(((IdNode*)a)->id), ((IdNode*)a)->depth, ((IdNode*)a)->slot}; break;
+            case AST::A_ELEMENT_GET: {
+                auto node = (ElementGetNode*)a;
+                ops.a = flatten(node->array_name);
+                ops.b = flatten(node->position);
+                break;
+            }
+            case AST::A_CALL: ops.a = flatten(((CallNode*)a)->func_name), ops.b = list(((CallNode*)a)->args); break;
+            case AST::A_ARRAY: ops.a = list(((ArrayNode*)a)->elements); break;
+            case AST::A_SELF_INC: ops = {flatten(((SelfIncNode*)a)->id), ((SelfIncNode*)a)->ipre, 0}; break;
+            case AST::A_SELF_DEC: ops = {flatten(((SelfDecNode*)a)->id), ((SelfDecNode*)a)->ipre, 0}; break;
+            case AST::A_VAR_DEF: {
+                auto node = (VarDefineNode*)a;
+                ops.a = intern(node->name);
+                ops.b = optional(node->init_value);
+                ops.c = node->slot;
+                break;
+            }
+            case AST::A_FUNC_DEFINE: {
+                auto node = (FunctionNode*)a;
+                ops.a = intern(node->name);
+                ops.b = list(node->args);
+                ops.c = flatten(node->body);
+                break;
+            }
+            case AST::A_LAMBDA: ops.a = list(((LambdaNode*)a)->args), ops.b = flatten(((LambdaNode*)a)->body); break;
+            case AST::A_SELF_OPERA: {
+                auto node = (SelfOperator*)a;
+                ops.a = flatten(node->target);
+                ops.b = flatten(node->value);
+                ops.c = (node->is_assign)? OP_COUNT : node->opcode;
+                break;
+            }
+            case AST::A_MEM_MALLOC: {
+                auto node = (MemoryMallocNode*)a;
+                ops.a = intern(node->name);
+                ops.b = (node->is_call_c)? list(node->args) : NO_NODE;
+                ops.c = node->class_slot;
+                break;
+            }
+            case AST::A_IMPORT: ops.a = intern(((ImportNode*)a)->path); break;
+            default: break;
+        }
+        out->operands[n] = ops;
+        return n;
+    }
+};
+
+inline FlatAST* flatten(const std::vector<AST*>& ast) {
+    auto flat = new FlatAST;
+    Flattener(flat).program(ast);
+    return flat;
+}
+
+// Checks that arrays read back from outside (the AST cache) describe a tree the
+// Flattener could have built: every index is in range, every node is reached once
+// and only from its preorder parent, and every local slot fits the scope the
+// resolver would have given it. Scopes are mirrored as in Parser::build_node.
+class FlatVerifier {
+public:
+    explicit FlatVerifier(const FlatAST& ast) : ast(ast), seen(ast.kinds.size(), false) {}
+
+    bool program() {
+        if (ast.operands.size() != ast.kinds.size()) return false;
+        for (auto& s : ast.strings)
+            if ((uint64_t)s.offset + s.size > ast.pool.size()) return false;
+        scopes.push_back({0, false});
+        return nodes(-1, ast.program);
+    }
+
+private:
+    struct Scope {
+        int size;
+        bool is_function;
+    };
+
+    const FlatAST& ast;
+    std::vector<bool> seen;
+    std::vector<Scope> scopes;
+
+    bool string(int32_t i) const { return i >= 0 && (size_t)i < ast.strings.size(); }
+
+    bool list(int32_t i) const {
+        return i >= 0 && (size_t)i < ast.extra.size() && ast.extra[i] >= 0
+            && (size_t)ast.extra[i] < ast.extra.size() - i;
+    }
+
+    bool nodes(NodeRef parent, int32_t i) {
+        if (!list(i)) return false;
+        for (auto n : ast.list(i))
+            if (!node(parent, n)) return false;
+        return true;
+    }
+
+    bool optional(NodeRef parent, NodeRef n) { return n == NO_NODE || node(parent, n); }
+
+    bool block(NodeRef parent, NodeRef n) {
+        if (!is(parent, n, AST::A_BLOCK) || ast.at(n).b < 0 || (size_t)ast.at(n).b > ast.kinds.size()) return false;
+        scopes.push_back({ast.at(n).b, false});
+        bool ok = node(parent, n);
+        scopes.pop_back();
+        return ok;
+    }
+
+    bool is(NodeRef parent, NodeRef n, AST::AKind kind) const {
+        return n > parent && (size_t)n < ast.kinds.size() && ast.kind(n) == kind;
+    }
+
+    // Function frames hold `this`, then the parameters, then the body's locals.
+    bool callable(NodeRef n, int32_t params, NodeRef body) {
+        if (!list(params) || !is(n, body, AST::A_BLOCK) || ast.at(body).b <= ast.extra[params]
+            || (size_t)ast.at(body).b > ast.kinds.size()) return false;
+        scopes.push_back({ast.at(body).b, true});
+        bool ok = true;
+        for (auto p : ast.list(params))
+            ok = ok && is(n, p, AST::A_VAR_DEF) && node(n, p);
+        ok = ok && node(n, body);
+        scopes.pop_back();
+        return ok;
+    }
+
+    bool id(const FlatAST::Operands& op) const {
+        if (op.b == IdNode::GLOBAL) return op.c == -1;
+        if (op.b < 0 || (size_t)op.b >= scopes.size() - 1) return false;
+        for (size_t i = scopes.size() - 1; i > scopes.size() - 1 - op.b; --i)
+            if (scopes[i].is_function) return false;
+        return op.c >= 0 && op.c < scopes[scopes.size() - 1 - op.b].size;
+    }
+
+    bool claim(NodeRef parent, NodeRef n) {
+        if (n <= parent || (size_t)n >= ast.kinds.size() || seen[n] || ast.kinds[n] > AST::A_NEG) return false;
+        return seen[n] = true;
+    }
+
+    bool node(NodeRef parent, NodeRef n) {
+        if (!claim(parent, n)) return false;
+        const FlatAST::Operands& op = ast.at(n);
+        switch (ast.kind(n)) {
+            case AST::A_IF: return node(n, op.a) && block(n, op.b) && (op.c == NO_NODE || block(n, op.c));
+            case AST::A_BLOCK: return op.b >= 0 && nodes(n, op.a);
+            case AST::A_STRING: case AST::A_IMPORT: return string(op.a);
+            case AST::A_INT: return op.a >= 0 && (size_t)op.a < ast.ints.size() && string(op.b);
+            case AST::A_FLO: return op.a >= 0 && (size_t)op.a < ast.floats.size() && string(op.b);
+            case AST::A_WHILE: return node(n, op.a) && block(n, op.b);
+            case AST::A_FOR: {
+                if (!is(n, op.a, AST::A_VAR_DEF) || op.c < 0 || (size_t)op.c + 1 >= ast.extra.size()) return false;
+                scopes.push_back({1, false});
+                bool ok = node(n, op.a) && node(n, op.b) && node(n, ast.extra[op.c]) && block(n, ast.extra[op.c + 1]);
+                scopes.pop_back();
+                return ok;
+            }
+            case AST::A_CLASS: {
+                if (!string(op.a) || !list(op.b) || ast.extra[op.b] % 2) return false;
+                NodeList members = ast.list(op.b);
+                for (int32_t i = 0; i < members.size(); i += 2) {
+                    NodeRef member = members[i + 1];
+                    if (!string(members[i])) return false;
+                    // Member fields only keep their initializer; their slot is never used.
+                    if (is(n, member, AST::A_VAR_DEF)) {
+                        if (!claim(n, member) || !string(ast.at(member).a) || !optional(member, ast.at(member).b)) return false;
+                    } else if (!is(n, member, AST::A_FUNC_DEFINE) || !node(n, member)) return false;
+                }
+                return true;
+            }
+            case AST::A_RETURN: return optional(n, op.a);
+            case AST::A_BIN_OP: return op.a >= 0 && op.a < OP_COUNT && node(n, op.b) && node(n, op.c);
+            case AST::A_NOT: case AST::A_NEG: case AST::A_BIT_NOT: return node(n, op.a);
+            case AST::A_MEMBER_ACCESS: return node(n, op.a) && string(op.b);
+            case AST::A_ID: return string(op.a) && id(op);
+            case AST::A_ELEMENT_GET: return node(n, op.a) && node(n, op.b);
+            case AST::A_CALL: return node(n, op.a) && nodes(n, op.b);
+            case AST::A_ARRAY: return nodes(n, op.a);
+            case AST::A_SELF_INC: case AST::A_SELF_DEC: return node(n, op.a);
+            case AST::A_VAR_DEF:
+                return string(op.a) && optional(n, op.b)
+                    && ((scopes.size() == 1)? op.c == -1 : op.c >= 0 && op.c < scopes.back().size);
+            case AST::A_FUNC_DEFINE: return string(op.a) && callable(n, op.b, op.c);
+            case AST::A_LAMBDA: return callable(n, op.a, op.b);
+            case AST::A_SELF_OPERA: return node(n, op.a) && node(n, op.b) && op.c >= 0 && op.c <= OP_COUNT;
+            case AST::A_MEM_MALLOC: return string(op.a) && (op.b == NO_NODE || nodes(n, op.b)) && op.c == -1;
+            default: return true;
+        }
+    }
+};
+
+std::string print_indent(int indent) {
+    std::string res;
+    while (indent--) res += "    ";
+    return res;
+}
+
+void decompiler(const FlatAST& ast, NodeRef n, int indent = 0, std::string fo = "") {
+    const FlatAST::Operands& op = ast.at(n);
+    switch (ast.kind(n)) {
+        case AST::A_ID: {
+            std::cout << print_indent(indent) << fo << "Id<" << ast.text(op.a) << ">\n";
+            break;
+        }
+        case AST::A_IF: {
+            std::cout << print_indent(indent) << fo << "IfNode {\n";
+            decompiler(ast, op.a, indent + 1, "Condition: ");
+            decompiler(ast, op.b, indent + 1, "IfConditionIsTrue: ");
+            if (op.c != NO_NODE) decompiler(ast, op.c, indent + 1, "IfNotTrue: ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_BLOCK: {
+            NodeList codes = ast.list(op.a);
+            std::cout << print_indent(indent) << fo << "Block {\n";
+            for (int i = 0; i < codes.size(); ++i)
+                decompiler(ast, codes[i], indent + 1, std::to_string(i) + ": ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_STRING: {
+            std::cout << print_indent(indent) << fo << "String('" << ast.text(op.a) << "')\n";
+            break;
+        }
+        case AST::A_INT: {
+            std::cout << print_indent(indent) << fo << "Int('" << ast.text(op.b) << "')\n";
+            break;
+        }
+        case AST::A_FLO: {
+            std::cout << print_indent(indent) << fo << "Float('" << ast.text(op.b) << "')\n";
+            break;
+        }
+        case AST::A_ARRAY: {
+            NodeList elements = ast.list(op.a);
+            std::cout << print_indent(indent) << fo << "Array: [\n";
+            for (int i = 0; i < elements.size(); ++i)
+                decompiler(ast, elements[i], indent + 1, "E[" + std::to_string(i) + "] = ");
+            std::cout << print_indent(indent) << "]\n";
+            break;
+        }
+        case AST::A_TRUE: {
+            std::cout << print_indent(indent) << fo << "Bool<true>\n";
+            break;
+        }
+        case AST::A_FALSE: {
+            std::cout << print_indent(indent) << fo << "Bool<false>\n";
+            break;
+        }
+        case AST::A_WHILE: {
+            std::cout << print_indent(indent) << fo << "WhileNode {\n";
+            decompiler(ast, op.a, indent + 1, "Condition: ");
+            decompiler(ast, op.b, indent + 1, "Body: ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_FOR: {
+            std::cout << print_indent(indent) << fo << "ForLoopNode {\n";
+            decompiler(ast, op.a, indent + 1, "ForLoopInit: ");
+            decompiler(ast, op.b, indent + 1, "LoopCondition: ");
+            decompiler(ast, ast.extra[op.c], indent + 1, "ForLoopChange: ");
+            decompiler(ast, ast.extra[op.c + 1], indent + 1, "ForLoopBody: ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_CLASS: {
+            NodeList members = ast.list(op.b);
+            std::cout << print_indent(indent) << fo << "Class {\n";
+            std::cout << print_indent(indent + 1) << "Name: " << ast.text(op.a) << std::endl;
+            if (!members.empty()) {
+                std::cout << print_indent(indent + 1) << "Members [\n";
+                for (int i = 0; i < members.size(); i += 2)
+                    decompiler(ast, members[i + 1], indent + 2, std::string(ast.text(members[i])) + ": ");
+                std::cout << print_indent(indent + 1) << "]\n";
+            }
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_RETURN: {
+            std::cout << print_indent(indent) << fo << "ReturnSignal(\n";
+            if (op.a != NO_NODE) decompiler(ast, op.a, indent + 1, "ReturnValue: ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_BREAK: {
+            std::cout << print_indent(indent) << fo << "<BreakSignal>\n";
+            break;
+        }
+        case AST::A_CONTINUE: {
+            std::cout << print_indent(indent) << fo << "<ContinueSignal>\n";
+            break;
+        }
+        case AST::A_NOT: {
+            std::cout << print_indent(indent) << fo << "Not(\n";
+            decompiler(ast, op.a, indent + 1);
+            std::cout << print_indent(indent) << ")\n";
+            break;
+        }
+        case AST::A_NEG: {
+            std::cout << print_indent(indent) << fo << "Neg(\n";
+            decompiler(ast, op.a, indent + 1);
+            std::cout << print_indent(indent) << ")\n";
+            break;
+        }
+        case AST::A_BIN_OP: {
+            std::cout << print_indent(indent) << fo << "BinOpNode: <'" << operator_names[op.a] << "'>{\n";
+            decompiler(ast, op.b, indent + 1, "Left: ");
+            decompiler(ast, op.c, indent + 1, "Right: ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_BIT_NOT: {
+            std::cout << print_indent(indent) << fo << "BitNode: ";
+            decompiler(ast, op.a, indent + 1);
+            break;
+        }
+        case AST::A_MEMBER_ACCESS: {
+            std::cout << print_indent(indent) << fo << "MemberAccessNode {\n";
+            decompiler(ast, op.a, indent + 1, "ParentClass: ");
+            std::cout << print_indent(indent + 1) << "Member: " << ast.text(op.b) << std::endl;
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_ELEMENT_GET: {
+            std::cout << print_indent(indent) << fo << "ElementGetNode {\n";
+            decompiler(ast, op.a, indent + 1, "ArrayAddress: ");
+            decompiler(ast, op.b, indent + 1, "Position: ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_CALL: {
+            NodeList args = ast.list(op.b);
+            std::cout << print_indent(indent) << fo << "CallNode { \n";
+            decompiler(ast, op.a, indent + 1, "FuncAddress: ");
+            std::cout << print_indent(indent + 1) << "Args: [" ;
+            std::string ind;
+            if (!args.empty()) {
+                printf("\n");
+                ind = print_indent(indent + 1);
+                for (int i = 0; i < args.size(); ++i)
+                    decompiler(ast, args[i], indent + 2, "Args[" + std::to_string(i) + "]: ");
+            }
+            std::cout << ind << "]\n";
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_SELF_INC: {
+            std::cout << print_indent(indent) << fo << "SelfInc {\n";
+            std::cout << print_indent(indent + 1) << "PRE: " << op.b << std::endl;
+            decompiler(ast, op.a, indent + 1, "Address: ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_SELF_DEC: {
+            std::cout << print_indent(indent) << fo << "SelfDec {\n";
+            std::cout << print_indent(indent + 1) << "PRE: " << op.b << std::endl;
+            decompiler(ast, op.a, indent + 1, "Address: ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_VAR_DEF: {
+            std::cout << print_indent(indent) << fo << "VarDefine {\n";
+            std::cout << print_indent(indent + 1) << "VarName: " << ast.text(op.a) << "\n";
+            if (op.b != NO_NODE) decompiler(ast, op.b, indent + 1, "InitValue: ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_FUNC_DEFINE: {
+            NodeList fn_arg = ast.list(op.b);
+            std::cout << print_indent(indent) << fo << "FunctionDefine<'" << ast.text(op.a) << "'> {\n";
+            std::cout << print_indent(indent + 1) << "FunctionArgs: ";
+            if (fn_arg.empty()) { std::cout << "[ ]\n"; }
+            else {
+                std::cout << "[\n";
+                for (int i = 0; i < fn_arg.size(); ++i)
+                    decompiler(ast, fn_arg[i], indent + 2, std::to_string(i) + ": ");
+                std::cout << print_indent(indent + 1) << "]\n";
+            }
+            decompiler(ast, op.c, indent + 1, "FuncBody: ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_SELF_OPERA: {
+            std::string spelling = (op.c == OP_COUNT)? "=" : operator_names[op.c] + "=";
+            std::cout << print_indent(indent) << fo << "SelfOperator<'" << spelling << "'> {\n";
+            decompiler(ast, op.a, indent + 1, "Target: ");
+            decompiler(ast, op.b, indent + 1, "Value: ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_LAMBDA: {
+            NodeList args = ast.list(op.a);
+            std::cout << print_indent(indent) << fo << "Lambda {\n";
+            std::cout << print_indent(indent + 1) << "Args: (\n";
+            for (int i = 0; i < args.size(); ++i)
+                decompiler(ast, args[i], indent + 2, std::to_string(i) + ": ");
+            std::cout << print_indent(indent + 1) << ")\n";
+            decompiler(ast, op.b, indent + 1, "Body: ");
+            std::cout << print_indent(indent) << "}\n";
+            break;
+        }
+        case AST::A_MEM_MALLOC: {
+            std::cout << print_indent(indent) << fo << "MemoryMalloc (\n";
+            if (op.b != NO_NODE) {
+                NodeList args = ast.list(op.b);
+                for (int i = 0; i < args.size(); ++i)
+                    decompiler(ast, args[i], indent + 1, std::to_string(i) + ": ");
+            }
+            std::cout << print_indent(indent) << ")\n";
+            break;
+        }
+        case AST::A_NULL: {
+            std::cout << print_indent(indent) << fo << "Null\n";
+            break;
+        }
+        case AST::A_IMPORT: {
+            std::cout << print_indent(indent) << "Import(" << ast.text(op.a) << ")\n";
+            break;
+        }
+        default: break;
+    }
+}
+
+#endif
@@ -2,498 +2,713 @@
 #define OPL_INTERPRETER_HPP
 
 #include <stdlib.h>
+#include <climits>
+#include <cstdint>
 #include <cstring>
 #include "parser.hpp"
+#include "ast_cache.hpp"
+#include "thread_pool.hpp"
 #include <iostream>
 #include <vector>
 #include "lexer.hpp"
+#include "file.hpp"
 #include <unordered_map>
+#include <unordered_set>
 #include <fstream>
-#include <functional>
+#include <cmath>
+#include <utility>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 
 class Interpreter;
-class Value;
-
-struct LValue {
-    std::function<Value*()> getter;
-    std::function<void(Value*)> setter;
-};
+class Object;
 
+// Values are NaN-boxed into one 64-bit word: a double is stored as itself, while
+// ints (48-bit), bools, null and references to heap Objects live in the
+// quiet-NaN space. Scalars are therefore passed around by value and never allocated.
 class Value {
 public:
     enum ValueKind {
-        V_FLOAT, V_INT, V_STRING, V_BOOL, V_ARRAY, V_FUNC, V_OBJECT, V_NULL, V_RT_RESULT
-    } kind;
-
-    Value(ValueKind kind) { this->kind = kind; }
+        V_FLOAT, V_INT, V_STRING, V_BOOL, V_ARRAY, V_FUNC, V_OBJECT, V_NULL
+    };
 
-    virtual void set(Value*) { operator_not_supposed_err("="); }
+    static constexpr int KIND_COUNT = V_NULL + 1;
 
-    virtual Value* bit_not() { operator_not_supposed_err("~"); }
+    Value() { bits = NULL_TAG; }
 
-    virtual Value* copy() { operator_not_supposed_err("copy"); }
+    Value(Object* object) { bits = REF_TAG | ((uint64_t)(uintptr_t)object & PAYLOAD_MASK); }
 
-    virtual Value* add(Value*) { operator_not_supposed_err("+"); }
+    static Value from_int(long long number);
 
-    virtual Value* sub(Value*) { operator_not_supposed_err("-"); }
-
-    virtual Value* div(Value*) { operator_not_supposed_err("/"); }
-
-    virtual Value* mul(Value*) { operator_not_supposed_err("*"); }
+    static Value from_float(double number) {
+        Value v;
+        if (number != number) v.bits = CANONICAL_NAN;
+        else std::memcpy(&v.bits, &number, sizeof(double));
+        return v;
+    }
 
-    virtual Value* left_move(Value*) { operator_not_supposed_err("<<"); }
+    static Value from_bool(bool b) {
+        Value v;
+        v.bits = BOOL_TAG | (uint64_t)b;
+        return v;
+    }
 
-    virtual std::string str() { operator_not_supposed_err("basicString"); }
+    static Value null() { return Value(); }
 
-    void expect(Value* v, ValueKind vk) {
-        if (v->kind != vk) {
-            std::cout << "InterpreterWantError: want " << vk << ", meet " << v->kind << std::endl;
-            exit(-1);
-        }
+    // Marks a slot whose variable has not been defined yet.
+    static Value undefined() {
+        Value v;
+        v.bits = UNDEF_TAG;
+        return v;
     }
 
-    virtual Value* right_move(Value*) { operator_not_supposed_err(">>"); }
+    inline bool is_float() const { return (bits & BOX_MASK) != BOX_MASK; }
 
-    virtual Value* is_eq(Value*) { operator_not_supposed_err("=="); }
+    inline bool is_small_int() const { return (bits & TAG_MASK) == INT_TAG; }
 
-    virtual Value* not_eq_(Value*) { operator_not_supposed_err("!="); }
+    inline bool is_bool() const { return (bits & TAG_MASK) == BOOL_TAG; }
 
-    virtual Value* cond_not() { operator_not_supposed_err("!"); }
+    inline bool is_null() const { return bits == NULL_TAG; }
 
-    virtual Value* big(Value*) { operator_not_supposed_err(">"); }
+    inline bool is_undefined() const { return bits == UNDEF_TAG; }
 
-    virtual Value* less(Value*) { operator_not_supposed_err("<"); }
+    inline bool is_object() const { return (bits & TAG_MASK) == REF_TAG; }
 
-    virtual Value* big_or_eq(Value*) { operator_not_supposed_err(">="); }
+    inline ValueKind kind() const;
 
-    virtual void element_set(Value*, Value*) { operator_not_supposed_err("[]="); }
+    inline long long as_int() const;
 
-    virtual Value* less_or_eq(Value*) { operator_not_supposed_err("<="); }
+    inline double as_float() const {
+        double d;
+        std::memcpy(&d, &bits, sizeof(double));
+        return d;
+    }
 
-    virtual Value* mod(Value*) { operator_not_supposed_err("%"); }
+    inline double as_number() const { return is_float()? as_float() : (double)as_int(); }
 
-    virtual Value* _pow(Value*) { operator_not_supposed_err("**"); }
+    inline bool as_bool() const { return bits == (BOOL_TAG | 1); }
 
-    virtual Value* element_get(Value*) { operator_not_supposed_err("[]"); }
+    inline Object* object() const { return (Object*)(uintptr_t)(bits & PAYLOAD_MASK); }
 
-    virtual Value* call(Value*) { operator_not_supposed_err("()"); }
+    inline bool same(Value other) const { return bits == other.bits; }
 
-    virtual Value* bit_not(Value*) { operator_not_supposed_err("~"); }
+    std::string str() const;
 
-    virtual Value* bit_or(Value*) { operator_not_supposed_err("|"); }
+    Value copy() const;
 
-    virtual Value* bit_and(Value*) { operator_not_supposed_err("&"); }
+    static constexpr long long SMALL_INT_MAX = (1LL << 47) - 1;
+    static constexpr long long SMALL_INT_MIN = -(1LL << 47);
 
-    virtual Value* __call__() { operator_not_supposed_err("()"); }
+private:
+    uint64_t bits;
+
+    static constexpr uint64_t BOX_MASK      = 0x7FFC000000000000ULL;
+    static constexpr uint64_t TAG_MASK      = 0xFFFF000000000000ULL;
+    static constexpr uint64_t PAYLOAD_MASK  = 0x0000FFFFFFFFFFFFULL;
+    static constexpr uint64_t INT_TAG       = 0x7FFC000000000000ULL;
+    static constexpr uint64_t BOOL_TAG      = 0x7FFD000000000000ULL;
+    static constexpr uint64_t NULL_TAG      = 0x7FFE000000000000ULL;
+    static constexpr uint64_t UNDEF_TAG     = 0x7FFF000000000000ULL;
+    static constexpr uint64_t REF_TAG       = 0xFFFC000000000000ULL;
+    static constexpr uint64_t CANONICAL_NAN = 0x7FF8000000000000ULL;
+};
 
-    virtual Value* cond_or(Value*) { operator_not_supposed_err("||"); }
+void operator_not_supposed_err(std::string op) {
+    std::cout << "OperatorNotOverloadError: '" << op << "'" << std::endl;
+    exit(-1);
+}
 
-    virtual Value* cond_and(Value*) { operator_not_supposed_err("&&"); }
+void expect(Value v, Value::ValueKind vk) {
+    if (v.kind() != vk) {
+        std::cout << "InterpreterWantError: want " << vk << ", meet " << v.kind() << std::endl;
+        exit(-1);
+    }
+}
 
-    void operator_not_supposed_err(std::string op) {
-        std::cout << "OperatorNotOverloadError: '" << op << "'" << std::endl;
+size_t in_range(long long index, size_t size) {
+    if (index < 0 || (unsigned long long)index >= size) {
+        std::cout << "IndexError: index " << index << " out of range for length " << size << std::endl;
         exit(-1);
     }
-};
+    return (size_t)index;
+}
+
+// Everything that does not fit into a Value (strings, arrays, objects, functions
+// and ints wider than 48 bits) is a heap Object referenced from a Value.
+class Heap;
 
-class RTResult : public Value {
+class Object {
 public:
-    enum SignalKind { S_BREAK, S_CONTINUE, S_RETURN, S_NONE } kind;
+    Value::ValueKind kind;
+    bool marked = false;
+    Object* next_object;
 
-    RTResult(SignalKind kind) : Value(V_RT_RESULT) {
-        this->kind = kind;
-    }
-};
+    Object(Value::ValueKind kind);
 
-class Null : public Value {
-public:
-    Null(): Value(V_NULL) {}
+    virtual ~Object() = default;
 
-    Value* copy() override {
-        return new Null();
-    }
+    // Marks the Values this object references.
+    virtual void trace(Heap&) { }
+
+    virtual Value copy() { operator_not_supposed_err("copy"); return Value(); }
+
+    virtual std::string str() { operator_not_supposed_err("basicString"); return ""; }
 
-    std::string str() override { return "Null"; }
+    virtual Value element_get(Value) { operator_not_supposed_err("[]"); return Value(); }
+
+    virtual void element_set(Value, Value) { operator_not_supposed_err("[]="); }
 };
 
-class Bool : public Value {
-public:
-    bool b;
-    Bool(std::string bl) : Value(V_BOOL) {
-        b = (bl == "true");
-    }
+// ======= Garbage collector
+// Every Object is threaded onto the heap's list when it is created. The
+// interpreter collects at statement boundaries once the live object count
+// reaches `next_collection`: it marks from its frames, the global context and
+// the pinned temporaries, then deletes every object left unmarked. After a
+// collection the trigger is set to `growth` times the surviving objects, but
+// never below `threshold`. Both can be set with OPL_GC_THRESHOLD and
+// OPL_GC_GROWTH; OPL_GC_THRESHOLD=0 OPL_GC_GROWTH=1 collects at every statement.
 
-    inline Value* copy() override { return new Bool(b); }
+class Heap {
+public:
+    Object* objects = nullptr;
+    size_t live = 0;
+    size_t threshold;
+    double growth;
+    size_t next_collection;
+    std::vector<Value> temps;
 
-    inline std::string str() override { return (b)? "True" : "False"; }
+    // Values held only by C++ locals while another sub-expression is evaluated
+    // are pinned; a PinScope drops the pins taken since it was opened.
+    struct PinScope {
+        size_t mark;
+        PinScope();
+        ~PinScope();
+    };
 
-    inline Bool(bool b) : Value(V_BOOL) {
-        this->b = b;
+    Heap() {
+        const char* t = std::getenv("OPL_GC_THRESHOLD");
+        const char* g = std::getenv("OPL_GC_GROWTH");
+        threshold = (t)? std::strtoull(t, nullptr, 10) : 100000;
+        growth = (g)? std::strtod(g, nullptr) : 2.0;
+        next_collection = threshold;
     }
 
-    void set(Value *v) override {
-        expect(v, V_BOOL);
-        this->b = ((Bool*)v)->b;
+    inline void track(Object* object) {
+        object->next_object = objects;
+        objects = object;
+        ++live;
     }
 
-    inline Value* cond_not() override { return new Bool(!b); }
+    inline bool should_collect() const { return live >= next_collection; }
 
-    inline Value* cond_and(Value* other) override { return new Bool(b && ((Bool*)other)->b); }
+    inline void pin(Value v) { if (v.is_object()) temps.push_back(v); }
 
-    inline Value* cond_or(Value* other) override { return new Bool(b || ((Bool*)other)->b); }
-};
+    inline void mark(Value v) { if (v.is_object()) mark(v.object()); }
 
-class Integer : public Value {
-public:
-    std::string number;
-    Integer(std::string number) : Value(V_INT) {
-        this->number = number;
+    inline void mark(Object* object) {
+        if (object->marked) return;
+        object->marked = true;
+        gray.push_back(object);
     }
 
-    inline std::string str() override { return number; }
-
-    inline Value* copy() override  { return new Integer(number); }
-
-    inline Value* bit_not() override {
-        return new Integer(std::to_string(~std::stoi(number)));
+    void mark_all(const std::vector<Value>& values) {
+        for (auto& v : values) mark(v);
     }
 
-    Value* is_eq(Value* other) override {
-        return new Bool(this->number == ((Integer*)other)->number && this->kind == other->kind);
+    // Finishes marking from the roots given so far and frees the rest.
+    void collect() {
+        mark_all(temps);
+        while (!gray.empty()) {
+            Object* object = gray.back();
+            gray.pop_back();
+            object->trace(*this);
+        }
+        Object** link = &objects;
+        while (*link) {
+            Object* object = *link;
+            if (object->marked) {
+                object->marked = false;
+                link = &object->next_object;
+            } else {
+                *link = object->next_object;
+                delete object;
+                --live;
+            }
+        }
+        next_collection = std::max(threshold, (size_t)(live * growth));
     }
 
-    Value* not_eq_(Value* other) override { return this->is_eq(other)->cond_not(); }
+private:
+    std::vector<Object*> gray;
+};
 
-    Value* big(Value* other) override {
-        return new Bool(std::stoi(this->number) > std::stoi(((Integer*)other)->number));
-    }
+Heap heap;
 
-    Value* less(Value* other) override {
-        return new Bool(std::stoi(this->number) < std::stoi(((Integer*)other)->number));
-    }
+inline Object::Object(Value::ValueKind kind) {
+    this->kind = kind;
+    heap.track(this);
+}
 
-    Value* less_or_eq(Value* other) override {
-        return new Bool(std::stoi(this->number) <= std::stoi(((Integer*)other)->number));
-    }
+inline Heap::PinScope::PinScope() { mark = heap.temps.size(); }
 
-    Value* big_or_eq(Value* other) override {
-        return new Bool(std::stoi(this->number) >= std::stoi(((Integer*)other)->number));
-    }
+inline Heap::PinScope::~PinScope() { heap.temps.resize(mark); }
 
-    Value* left_move(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stoi(this->number) << std::stoi(((Integer*)other)->number)
-                )
-        );
-    }
+inline Object* heap_operand(Value v, std::string op) {
+    if (!v.is_object()) operator_not_supposed_err(op);
+    return v.object();
+}
 
-    Value* right_move(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stoi(this->number) >> std::stoi(((Integer*)other)->number)
-                )
-        );
+// Ints that overflow the 48-bit inline payload are boxed.
+class Integer : public Object {
+public:
+    long long number;
+    Integer(long long number) : Object(Value::V_INT) {
+        this->number = number;
     }
 
-    Value* mod(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stoi(this->number) % std::stoi(((Integer*)other)->number)
-                )
-        );
-    }
+    inline std::string str() override { return std::to_string(number); }
 
-    Value* bit_or(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stoi(this->number) | std::stoi(((Integer*)other)->number)
-                )
-        );
-    }
+    inline Value copy() override { return this; }
+};
 
-    Value* bit_and(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stoi(this->number) && std::stoi(((Integer*)other)->number)
-                )
-        );
+inline Value Value::from_int(long long number) {
+    if (number < SMALL_INT_MIN || number > SMALL_INT_MAX)
+        return Value(new Integer(number));
+    Value v;
+    v.bits = INT_TAG | ((uint64_t)number & PAYLOAD_MASK);
+    return v;
+}
+
+inline Value::ValueKind Value::kind() const {
+    if (is_float()) return V_FLOAT;
+    switch (bits & TAG_MASK) {
+        case INT_TAG: return V_INT;
+        case BOOL_TAG: return V_BOOL;
+        case NULL_TAG: case UNDEF_TAG: return V_NULL;
+        default: return object()->kind;
+    }
+}
+
+inline long long Value::as_int() const {
+    if (is_small_int()) return (long long)(bits << 16) >> 16;
+    return ((Integer*)object())->number;
+}
+
+std::string format_float(double number) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.15g", number);
+    if (std::strtod(buffer, nullptr) != number)
+        snprintf(buffer, sizeof(buffer), "%.17g", number);
+    std::string res = buffer;
+    if (res.find_first_of(".eni") == std::string::npos) res += ".0";
+    return res;
+}
+
+std::string Value::str() const {
+    switch (kind()) {
+        case V_FLOAT: return format_float(as_float());
+        case V_INT: return std::to_string(as_int());
+        case V_BOOL: return as_bool()? "True" : "False";
+        case V_NULL: return "Null";
+        default: return object()->str();
+    }
+}
+
+Value Value::copy() const {
+    if (is_object()) return object()->copy();
+    return *this;
+}
+
+class Array : public Object {
+public:
+    std::vector<Value> elements;
+    Array(std::vector<Value> elements) : Object(Value::V_ARRAY) {
+        this->elements = elements;
     }
 
-    Value* add(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stoi(this->number) + std::stoi(((Integer*)other)->number)
-                )
-        );
-    }
+    Value copy() override { return new Array(elements); }
 
-    Value* div(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stoi(this->number) / std::stoi(((Integer*)other)->number)
-                )
-        );
+    std::string str() override {
+        std::string s = "[";
+        for (int i = 0; i < elements.size(); ++i) {
+            s += elements[i].str();
+            if (i != elements.size() - 1) s += ", ";
+        }
+        s += "]";
+        return s;
     }
 
-    Value* sub(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stoi(this->number) - std::stoi(((Integer*)other)->number)
-                )
-        );
+    void element_set(Value position, Value value) override {
+        expect(position, Value::V_INT);
+        this->elements[in_range(position.as_int(), elements.size())] = value;
     }
 
-    Value* mul(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stoi(this->number) * std::stoi(((Integer*)other)->number)
-                )
-        );
-    }
+    inline void append(Value value) { elements.push_back(value); }
 
-    void set(Value* other) override {
-        if (other->kind == V_FLOAT) {
-            number = std::to_string(std::stoi(((Integer*)other)->number));
-            return;
+    void trace(Heap& h) override { h.mark_all(elements); }
+
+    Value element_get(Value position) override {
+        if (position.kind() != Value::V_INT) {
+            std::cout << "Not a number\n";
+            exit(-1);
         }
-        expect(other, V_INT);
-        this->number = ((Integer*)other)->number;
+        return elements[in_range(position.as_int(), elements.size())];
     }
-
 };
 
-class Float : public Value {
+// A string either owns its text or, when it came from Read, is a read-only view
+// of the mapped file; the view is copied into basicString on the first write.
+class String : public Object {
 public:
-    std::string number;
-    Float(std::string number) : Value(V_FLOAT) {
-        this->number = number;
+    std::string basicString;
+    String(std::string str) : Object(Value::V_STRING) {
+        this->basicString = std::move(str);
     }
 
-    void set(Value* other) override {
-        if (other->kind == V_INT) {
-            number = std::to_string(std::stod(((Integer*)other)->number));
-            return;
-        }
-        expect(other, V_FLOAT);
-        this->number = ((Float*)other)->number;
+    String(std::shared_ptr<MappedFile> file) : Object(Value::V_STRING) {
+        this->file = std::move(file);
     }
 
-    inline Value* copy() override { return new Float(number); }
+    inline std::string_view text() const { return (file)? file->view() : std::string_view(basicString); }
 
-    inline std::string str() override { return number; }
+    inline Value copy() override { return (file)? new String(file) : new String(basicString); }
 
-    Value* bit_and(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stod(this->number) && std::stod(((Integer*)other)->number)
-                )
-        );
-    }
+    inline std::string str() override { return std::string(text()); }
 
-    Value* is_eq(Value* other) override {
-        return new Bool(this->number == ((Integer*)other)->number && this->kind == other->kind);
+    void element_set(Value position, Value value) override {
+        expect(position, Value::V_INT);
+        expect(value, Value::V_STRING);
+        std::string& text = own();
+        text[in_range(position.as_int(), text.size())] = ((String*)value.object())->text()[0];
     }
 
-    Value* not_eq_(Value* other) override {
-        return this->is_eq(other)->cond_not();
+    Value element_get(Value position) override {
+        expect(position, Value::V_INT);
+        std::string res;
+        res += text()[in_range(position.as_int(), text().size())];
+        return new String(res);
     }
 
-    Value* big(Value* other) override {
-        return new Bool(std::stod(this->number) > std::stod(((Integer*)other)->number));
-    }
+private:
+    std::shared_ptr<MappedFile> file;
 
-    Value* less(Value* other) override {
-        return new Bool(std::stod(this->number) < std::stod(((Integer*)other)->number));
+    std::string& own() {
+        if (file) basicString = std::string(file->view()), file.reset();
+        return basicString;
     }
+};
 
-    Value* less_or_eq(Value* other) override {
-        return new Bool(std::stod(this->number) <= std::stod(((Integer*)other)->number));
-    }
+// ======= Operators
+// Binary operators are dispatched through a table indexed by the operator and the
+// kinds of both operands, so picking the type-specialized kernel is a single
+// indexed load. Combinations without a kernel report OperatorNotOverloadError.
 
-    Value* big_or_eq(Value* other) override {
-        return new Bool(std::stod(this->number) >= std::stod(((Integer*)other)->number));
-    }
+using BinaryKernel = Value(*)(Value, Value);
 
-    Value* add(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stod(this->number) * std::stod(((Integer*)other)->number)
-                )
-        );
+long long non_zero(long long divisor) {
+    if (divisor == 0) {
+        std::cout << "ZeroDivisionError: integer division or modulo by zero" << std::endl;
+        exit(-1);
     }
+    return divisor;
+}
 
-    Value* div(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stod(this->number) / std::stod(((Integer*)other)->number)
-                )
-        );
+long long shift_count(long long count) {
+    if (count < 0) {
+        std::cout << "ValueError: negative shift count" << std::endl;
+        exit(-1);
     }
+    return count;
+}
 
-    Value* sub(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stod(this->number) - std::stod(((Integer*)other)->number)
-                )
-        );
-    }
+long long int_operand(Value v, std::string op) {
+    if (v.kind() != Value::V_INT) operator_not_supposed_err(op);
+    return v.as_int();
+}
+
+inline std::string_view string_of(Value v) { return ((String*)v.object())->text(); }
 
-    Value* mul(Value* other) override {
-        return new Integer(
-                std::to_string(
-                        std::stod(this->number) * std::stod(((Integer*)other)->number)
-                )
-        );
+// exact() stores the int result and returns false when it does not fit in 64 bits.
+struct AddOp {
+    template<typename T> static T apply(T a, T b) { return a + b; }
+    static bool exact(long long a, long long b, long long* out) {
+#if defined(__GNUC__) || defined(__clang__)
+        return !__builtin_add_overflow(a, b, out);
+#else
+        if ((b > 0 && a > LLONG_MAX - b) || (b < 0 && a < LLONG_MIN - b)) return false;
+        *out = a + b;
+        return true;
+#endif
     }
 };
-
-class Array : public Value {
-public:
-    std::vector<Value*> elements;
-    Array(std::vector<Value*> elements) : Value(V_ARRAY) {
-        this->elements = elements;
+struct SubOp {
+    template<typename T> static T apply(T a, T b) { return a - b; }
+    static bool exact(long long a, long long b, long long* out) {
+#if defined(__GNUC__) || defined(__clang__)
+        return !__builtin_sub_overflow(a, b, out);
+#else
+        if ((b < 0 && a > LLONG_MAX + b) || (b > 0 && a < LLONG_MIN + b)) return false;
+        *out = a - b;
+        return true;
+#endif
+    }
+};
+struct MulOp {
+    template<typename T> static T apply(T a, T b) { return a * b; }
+    static bool exact(long long a, long long b, long long* out) {
+#if defined(__GNUC__) || defined(__clang__)
+        return !__builtin_mul_overflow(a, b, out);
+#else
+        if (a > 0? (b > 0? a > LLONG_MAX / b : b < LLONG_MIN / a)
+                  : (b > 0? a < LLONG_MIN / b : a != 0 && b < LLONG_MAX / a)) return false;
+        *out = a * b;
+        return true;
+#endif
     }
+};
+struct DivOp {
+    static long long apply(long long a, long long b) { return a / non_zero(b); }
+    static double apply(double a, double b) { return a / b; }
+};
+struct ModOp {
+    static long long apply(long long a, long long b) { return a % non_zero(b); }
+    static double apply(double a, double b) { return std::fmod(a, b); }
+};
+struct PowOp { static double apply(double a, double b) { return std::pow(a, b); } };
+struct BitAndOp { static long long apply(long long a, long long b) { return a & b; } };
+struct BitOrOp { static long long apply(long long a, long long b) { return a | b; } };
+struct BitXorOp { static long long apply(long long a, long long b) { return a ^ b; } };
 
-    Value* copy() override { return new Array(elements); }
+struct EqOp { template<typename T> static bool apply(const T& a, const T& b) { return a == b; } };
+struct NotEqOp { template<typename T> static bool apply(const T& a, const T& b) { return a != b; } };
+struct LessOp { template<typename T> static bool apply(const T& a, const T& b) { return a < b; } };
+struct BigOp { template<typename T> static bool apply(const T& a, const T& b) { return a > b; } };
+struct LessOrEqOp { template<typename T> static bool apply(const T& a, const T& b) { return a <= b; } };
+struct BigOrEqOp { template<typename T> static bool apply(const T& a, const T& b) { return a >= b; } };
+struct CondAndOp { static bool apply(bool a, bool b) { return a && b; } };
+struct CondOrOp { static bool apply(bool a, bool b) { return a || b; } };
 
-    void set(Value* val) override {
-        expect(val, V_ARRAY);
-        this->elements = ((Array*)val)->elements;
-    }
+template<class Op> Value int_int(Value l, Value r) { return Value::from_int(Op::apply(l.as_int(), r.as_int())); }
 
-    std::string str() override {
-        std::string s = "[";
-        for (int i = 0; i < elements.size(); ++i) {
-            s += elements[i]->str();
-            if (i != elements.size() - 1) s += ", ";
-        }
-        s += "]";
-        return s;
-    }
+// For +, - and *: an int result too wide for 64 bits becomes a float.
+template<class Op> Value exact_int_int(Value l, Value r) {
+    long long a = l.as_int(), b = r.as_int(), result;
+    if (Op::exact(a, b, &result)) return Value::from_int(result);
+    return Value::from_float(Op::apply((double)a, (double)b));
+}
 
-    void element_set(Value* position, Value* value) override {
-        int pos = std::stoi(((Integer*)position)->number);
-        this->elements[pos] = value;
-    }
+template<class Op> Value float_float(Value l, Value r) { return Value::from_float(Op::apply(l.as_float(), r.as_float())); }
 
-    inline void append(Value* value) { elements.push_back(value); }
+template<class Op> Value int_float(Value l, Value r) { return Value::from_float(Op::apply((double)l.as_int(), r.as_float())); }
 
-    Value* element_get(Value* position) override {
-        if (position->kind != ValueKind::V_INT) {
-            std::cout << "Not a number\n";
-            exit(-1);
-        }
-        int pos = std::stoi(((Integer*)position)->number);
-        return elements[pos];
-    }
-};
+template<class Op> Value float_int(Value l, Value r) { return Value::from_float(Op::apply(l.as_float(), (double)r.as_int())); }
 
-class String : public Value {
-public:
-    std::string basicString;
-    String(std::string str) : Value(V_STRING) {
-        this->basicString = str;
-    }
+template<class Op> Value cmp_int_int(Value l, Value r) { return Value::from_bool(Op::apply(l.as_int(), r.as_int())); }
 
-    inline Value* copy() override { return new String(basicString); }
+template<class Op> Value cmp_float_float(Value l, Value r) { return Value::from_bool(Op::apply(l.as_float(), r.as_float())); }
 
-    void set(Value* value) override {
-        expect(value, V_STRING);
-        this->basicString = ((String*)value)->basicString;
-    }
+template<class Op> Value cmp_int_float(Value l, Value r) { return Value::from_bool(Op::apply((double)l.as_int(), r.as_float())); }
 
-    inline std::string str() override { return basicString; }
+template<class Op> Value cmp_float_int(Value l, Value r) { return Value::from_bool(Op::apply(l.as_float(), (double)r.as_int())); }
 
-    void element_set(Value* position, Value* value) override {
-        int pos = std::stoi(((Integer*)position)->number);
-        this->basicString[pos] = ((String*)value)->basicString[0];
-    }
+template<class Op> Value cmp_string_string(Value l, Value r) { return Value::from_bool(Op::apply(string_of(l), string_of(r))); }
 
-    Value* element_get(Value* position) override {
-        std::string res;
-        res += this->basicString[std::stoi(((Integer*)position)->number)];
-        return new String(res);
-    }
+template<class Op> Value cmp_bool_bool(Value l, Value r) { return Value::from_bool(Op::apply(l.as_bool(), r.as_bool())); }
 
-    Value* less(Value* other) override {
-        return new Bool((int)basicString[0] < (int)((String*)other)->basicString[0]);
-    }
+template<class Op> Value cmp_identity(Value l, Value r) { return Value::from_bool(Op::apply(l.object(), r.object())); }
 
-    Value* big(Value* other) override {
-        return new Bool((int)basicString[0] > (int)((String*)other)->basicString[0]);
-    }
+template<bool Result> Value constant_bool(Value, Value) { return Value::from_bool(Result); }
 
-    Value* less_or_eq(Value* other) override {
-        return new Bool((int)basicString[0] <= (int)((String*)other)->basicString[0]);
+// Square and multiply; a result too wide for 64 bits becomes a float, as for *.
+Value pow_int_int(Value l, Value r) {
+    long long base = l.as_int(), exp = r.as_int(), res = 1;
+    if (exp < 0) return Value::from_float(std::pow((double)base, (double)exp));
+    while (true) {
+        if ((exp & 1) && !MulOp::exact(res, base, &res)) break;
+        exp >>= 1;
+        if (!exp) return Value::from_int(res);
+        if (!MulOp::exact(base, base, &base)) break;
     }
+    return Value::from_float(std::pow((double)l.as_int(), (double)r.as_int()));
+}
 
-    Value* big_or_eq(Value* other) override {
-        return new Bool((int)basicString[0] >= (int)((String*)other)->basicString[0]);
-    }
+// A left shift that would drop set bits becomes a float, as for *.
+Value left_move_int_int(Value l, Value r) {
+    long long a = l.as_int(), b = shift_count(r.as_int());
+    if (a == 0) return Value::from_int(0);
+    if (b <= 63 && (a >> (63 - b)) == (a >> 63)) return Value::from_int((long long)((unsigned long long)a << b));
+    return Value::from_float(std::ldexp((double)a, (int)std::min(b, 4096LL)));
+}
+
+Value right_move_int_int(Value l, Value r) { return Value::from_int(l.as_int() >> std::min(shift_count(r.as_int()), 63LL)); }
+
+Value concat_string_string(Value l, Value r) { return new String(std::string(string_of(l)).append(string_of(r))); }
 
-    Value* not_eq_(Value* other) override {
-        return new Bool(basicString != ((String*)other)->basicString);
+Value concat_string_scalar(Value l, Value r) { return new String(std::string(string_of(l)).append(r.str())); }
+
+Value repeat_string_int(Value l, Value r) {
+    std::string tmp;
+    for (auto t = r.as_int(); t > 0; --t) tmp.append(string_of(l));
+    return new String(tmp);
+}
+
+template<int OP> Value unsupported(Value, Value) {
+    operator_not_supposed_err(operator_names[OP]);
+    return Value();
+}
+
+class OperatorTable {
+public:
+    BinaryKernel kernels[OP_COUNT][Value::KIND_COUNT][Value::KIND_COUNT];
+
+    OperatorTable() {
+        fill_unsupported(std::make_integer_sequence<int, OP_COUNT>());
+
+        numeric<AddOp>(OP_ADD);
+        numeric<SubOp>(OP_SUB);
+        numeric<MulOp>(OP_MUL);
+        set(OP_ADD, Value::V_INT, Value::V_INT, exact_int_int<AddOp>);
+        set(OP_SUB, Value::V_INT, Value::V_INT, exact_int_int<SubOp>);
+        set(OP_MUL, Value::V_INT, Value::V_INT, exact_int_int<MulOp>);
+        numeric<DivOp>(OP_DIV);
+        numeric<ModOp>(OP_MOD);
+        set(OP_POW, Value::V_INT, Value::V_INT, pow_int_int);
+        set(OP_POW, Value::V_FLOAT, Value::V_FLOAT, float_float<PowOp>);
+        set(OP_POW, Value::V_INT, Value::V_FLOAT, int_float<PowOp>);
+        set(OP_POW, Value::V_FLOAT, Value::V_INT, float_int<PowOp>);
+        set(OP_BIT_AND, Value::V_INT, Value::V_INT, int_int<BitAndOp>);
+        set(OP_BIT_OR, Value::V_INT, Value::V_INT, int_int<BitOrOp>);
+        set(OP_BIT_XOR, Value::V_INT, Value::V_INT, int_int<BitXorOp>);
+        set(OP_LEFT_MOVE, Value::V_INT, Value::V_INT, left_move_int_int);
+        set(OP_RIGHT_MOVE, Value::V_INT, Value::V_INT, right_move_int_int);
+
+        set(OP_ADD, Value::V_STRING, Value::V_STRING, concat_string_string);
+        set(OP_ADD, Value::V_STRING, Value::V_INT, concat_string_scalar);
+        set(OP_ADD, Value::V_STRING, Value::V_FLOAT, concat_string_scalar);
+        set(OP_MUL, Value::V_STRING, Value::V_INT, repeat_string_int);
+
+        comparison<EqOp>(OP_EQ);
+        comparison<NotEqOp>(OP_NOT_EQ);
+        comparison<LessOp>(OP_LESS);
+        comparison<BigOp>(OP_BIG);
+        comparison<LessOrEqOp>(OP_LESS_OR_EQ);
+        comparison<BigOrEqOp>(OP_BIG_OR_EQ);
+
+        // Values of different kinds are never equal; values of the same kind
+        // without a dedicated kernel compare by identity.
+        for (int l = 0; l < Value::KIND_COUNT; ++l)
+            for (int r = 0; r < Value::KIND_COUNT; ++r) {
+                if (kernels[OP_EQ][l][r] != unsupported<OP_EQ>) continue;
+                kernels[OP_EQ][l][r] = (l == r)? cmp_identity<EqOp> : constant_bool<false>;
+                kernels[OP_NOT_EQ][l][r] = (l == r)? cmp_identity<NotEqOp> : constant_bool<true>;
+            }
+        set(OP_EQ, Value::V_BOOL, Value::V_BOOL, cmp_bool_bool<EqOp>);
+        set(OP_NOT_EQ, Value::V_BOOL, Value::V_BOOL, cmp_bool_bool<NotEqOp>);
+        set(OP_EQ, Value::V_NULL, Value::V_NULL, constant_bool<true>);
+        set(OP_NOT_EQ, Value::V_NULL, Value::V_NULL, constant_bool<false>);
+
+        set(OP_COND_AND, Value::V_BOOL, Value::V_BOOL, cmp_bool_bool<CondAndOp>);
+        set(OP_COND_OR, Value::V_BOOL, Value::V_BOOL, cmp_bool_bool<CondOrOp>);
     }
 
-    Value* is_eq(Value* other) override {
-        return new Bool(basicString == ((String*)other)->basicString);
+private:
+    void set(Operator op, Value::ValueKind l, Value::ValueKind r, BinaryKernel kernel) { kernels[op][l][r] = kernel; }
+
+    template<int... OPS>
+    void fill_unsupported(std::integer_sequence<int, OPS...>) {
+        BinaryKernel defaults[] = { unsupported<OPS>... };
+        for (int op = 0; op < OP_COUNT; ++op)
+            for (int l = 0; l < Value::KIND_COUNT; ++l)
+                for (int r = 0; r < Value::KIND_COUNT; ++r)
+                    kernels[op][l][r] = defaults[op];
     }
 
-    Value* mul(Value* other) override {
-        expect(other, V_INT);
-        auto t = std::stoi(((Integer*)other)->number);
-        std::string tmp;
-        while (t--) tmp += basicString;
-        return new String(tmp);
+    template<class Op>
+    void numeric(Operator op) {
+        set(op, Value::V_INT, Value::V_INT, int_int<Op>);
+        set(op, Value::V_FLOAT, Value::V_FLOAT, float_float<Op>);
+        set(op, Value::V_INT, Value::V_FLOAT, int_float<Op>);
+        set(op, Value::V_FLOAT, Value::V_INT, float_int<Op>);
     }
 
-    Value* add(Value* other) override {
-        switch (other->kind) {
-            case Value::V_STRING: return new String(this->basicString + ((String*)other)->basicString);
-            case Value::V_FLOAT: case Value::V_INT: return new String(this->basicString + ((Integer*)other)->number);
-            default: this->operator_not_supposed_err("+");
-        }
+    template<class Op>
+    void comparison(Operator op) {
+        set(op, Value::V_INT, Value::V_INT, cmp_int_int<Op>);
+        set(op, Value::V_FLOAT, Value::V_FLOAT, cmp_float_float<Op>);
+        set(op, Value::V_INT, Value::V_FLOAT, cmp_int_float<Op>);
+        set(op, Value::V_FLOAT, Value::V_INT, cmp_float_int<Op>);
+        set(op, Value::V_STRING, Value::V_STRING, cmp_string_string<Op>);
     }
 };
 
-class Function : public Value {
+const OperatorTable operator_table;
+
+inline Value binary_operation(Operator op, Value l, Value r) {
+    return operator_table.kernels[op][l.kind()][r.kind()](l, r);
+}
+
+Value op_cond_not(Value v) {
+    expect(v, Value::V_BOOL);
+    return Value::from_bool(!v.as_bool());
+}
+
+Value op_bit_not(Value v) { return Value::from_int(~int_operand(v, "~")); }
+
+Value op_neg(Value v) {
+    if (v.kind() == Value::V_FLOAT) return Value::from_float(-v.as_float());
+    return Value::from_int(-int_operand(v, "-"));
+}
+
+class Function : public Object {
 public:
     enum FunctionKind {
         F_USER_DEFINE,
-        F_BUILD_IN
+        F_BUILD_IN,
+        F_COMPILED
     } fun_kind;
 
     std::string name;
 
-    Function(FunctionKind k, std::string name) : Value(V_FUNC) {
+    Function(FunctionKind k, std::string name) : Object(Value::V_FUNC) {
         this->fun_kind = k;
+        this->name = name;
     }
+
+    Value copy() override { return this; }
 };
 
 class UserDefineFunction : public Function {
 public:
     std::vector<std::string> args;
-    std::vector<AST*> body;
-    UserDefineFunction(std::string name, std::vector<std::string> args, std::vector<AST*> body) : Function(F_USER_DEFINE, name) {
+    FlatAST* code; // module the body was defined in
+    NodeRef body;  // A_BLOCK
+    int frame_size;
+    UserDefineFunction(std::string name, std::vector<std::string> args, FlatAST* code, NodeRef body) : Function(F_USER_DEFINE, name) {
         this->args = args;
+        this->code = code;
         this->body = body;
         this->name = name;
+        this->frame_size = code->at(body).b;
     }
 };
 
-using MF = Value*(Interpreter::*)(std::vector<Value*>);
-
+// A scope keeps its variables in a flat slot vector addressed by the (depth, slot)
+// pairs the parser's resolver assigns. Only the root context also indexes its
+// slots by name, for builtins, top-level definitions and imported modules.
 class Context {
 public:
     bool is_have_std = false;
     Context* parent_context;
-    std::unordered_map<std::string, Value*> table;
+    std::vector<Value> slots;
+    std::unordered_map<std::string, int> index;
     std::string display_name;
 
-    Context(std::string display_name, Context* parent = nullptr){
+    Context(std::string display_name, Context* parent = nullptr, int size = 0) {
         this->display_name = display_name;
         this->parent_context = parent;
+        this->slots.assign(size, Value::undefined());
     }
 
     Context* get_global() {
@@ -502,710 +717,839 @@ public:
         return this;
     }
 
-    bool is_exist_in_this_level(std::string name) {
-        return table.find(name) != table.end();
-    }
+    inline void reset() { std::fill(slots.begin(), slots.end(), Value::undefined()); }
 
-    Value* get(std::string name) {
-        if (!is_exist_in_this_level(name) && parent_context)
-            return parent_context->get(name);
-        ce(name);
-        return table[name];
+    inline Context* up(int depth) {
+        Context* c = this;
+        while (depth--) c = c->parent_context;
+        return c;
     }
 
-    void ce(std::string name) {
-        if (!is_exist_in_this_level(name)) {
-            std::cout << "Name '" << name << "' is not define in scope '" << display_name << "'\n";
-            exit(-1);
-        }
+    int find(std::string name) {
+        auto found = index.find(name);
+        return (found == index.end())? -1 : found->second;
     }
 
-    void check(std::string name) {
-        if (is_exist_in_this_level(name)) {
-            std::cout << "Name '" << name << "' double define in scope '" << display_name << "'\n";
-            exit(-1);
-        }
+    Value get(std::string name) {
+        int slot = find(name);
+        if (slot < 0) not_defined(name);
+        return slots[slot];
     }
 
-    void add(std::string name, Value* value) {
-        check(name);
-        table[name] = value;
+    void not_defined(std::string name) {
+        std::cout << "Name '" << name << "' is not define in scope '" << display_name << "'\n";
+        exit(-1);
     }
 
-    void set(std::string name, Value* value) {
-        if (!parent_context && !is_exist_in_this_level(name)) {
-            std::cout << "Name '" << name << "' is not define\n";
+    void add(std::string name, Value value) {
+        if (find(name) >= 0) {
+            std::cout << "Name '" << name << "' double define in scope '" << display_name << "'\n";
             exit(-1);
         }
-        if (is_exist_in_this_level(name)) {
-            table[name] = value;
-            return;
-        }
-        parent_context->set(name, value);
+        index[name] = (int)slots.size();
+        slots.push_back(value);
     }
 };
 
-class BasicObject : public Value {
+// Member names live here for the whole run, so objects can key their members
+// by string_view and look them up without building a std::string.
+inline std::string_view intern_name(std::string_view name) {
+    static std::unordered_set<std::string> names;
+    return *names.insert(std::string(name)).first;
+}
+
+class BasicObject : public Object {
 public:
+    using Members = std::unordered_map<std::string_view, Value>; // keys from intern_name
+
     std::string name;
-    std::unordered_map<std::string, Value*> members;
-    BasicObject(std::string name, std::unordered_map<std::string, Value*> members) : Value(V_OBJECT) {
-        this->members = members;
+    Members members;
+    BasicObject(std::string name, const std::unordered_map<std::string, Value>& members) : Object(Value::V_OBJECT) {
+        for (auto& i : members) this->members.emplace(intern_name(i.first), i.second);
+        this->name = name;
+    }
+
+    BasicObject(std::string name, Members members) : Object(Value::V_OBJECT) {
+        this->members = std::move(members);
         this->name = name;
     }
 
-    Value* copy() override {
+    Value copy() override {
         return new BasicObject(name, members);
     }
 
-    BasicObject() : Value(V_OBJECT) { }
+    BasicObject() : Object(Value::V_OBJECT) { }
 
-    bool is_exist(std::string _name) { return members.find(_name) != members.end(); }
+    bool is_exist(std::string_view _name) { return members.find(_name) != members.end(); }
 
-    void add(std::string _name, Value* value) {
+    void add(std::string_view _name, Value value) {
         check(_name);
-        members[_name] = value;
+        members.emplace(intern_name(_name), value);
     }
 
-    void check(std::string _name) {
+    void check(std::string_view _name) {
         if (is_exist(_name)) {
             std::cout << "Name '" << _name << "' is double define\n";
             exit(-1);
         }
     }
 
-    Value* get_constructor() {
+    Value get_constructor() {
         return get("constructor");
     }
 
-    Value* get(std::string _name) {
-        if (!is_exist(_name)){
+    Value get(std::string_view _name) {
+        auto found = members.find(_name);
+        if (found == members.end()) {
             std::cout << "Name '" << _name << "' is not define in object '" << this->name << "'\n";
             exit(-1);
         }
-        return members[_name];
+        return found->second;
     }
 
-    void set(std::string _name, Value* value) {
-        members[_name] = value;
+    void set(std::string_view _name, Value value) {
+        auto found = members.find(_name);
+        if (found != members.end()) found->second = value;
+        else members.emplace(intern_name(_name), value);
     }
+
+    void trace(Heap& h) override {
+        for (auto& i : members) h.mark(i.second);
+    }
+};
+
+// The evaluated arguments of a call, viewed where the caller keeps them.
+struct Arguments {
+    const Value* items;
+    int count;
+
+    const Value* begin() const { return items; }
+    const Value* end() const { return items + count; }
+    int size() const { return count; }
+    Value operator[](int i) const { return items[i]; }
 };
 
+using BuildInFunction = Value(*)(Arguments);
+
 class BuildInFunctions : public Function {
 public:
-    MF member_function;
-    std::vector<Value*> args;
-    Interpreter* ip;
-    BuildInFunctions(std::string name, MF mf) : Function(F_BUILD_IN, name) {
-        this->member_function = mf;
+    BuildInFunction function;
+    BuildInFunctions(std::string name, BuildInFunction function) : Function(F_BUILD_IN, name) {
+        this->function = function;
     }
 
-    Value* __call__(Interpreter* _ip, std::vector<Value*> _args) {
-        this->ip = _ip;
-        this->args = _args;
-        return (ip->*member_function)(args);
+    Value __call__(Arguments args) {
+        return function(args);
     }
 };
 
+Value system_print(Arguments args) {
+    for (auto i : args)
+        std::cout << i.str();
+    return Value::null();
+}
+
+Value system_println(Arguments args) {
+    system_print(args);
+    printf("\n");
+    return Value::null();
+}
+
+Value system_not_null(Arguments args) {
+    return Value::from_bool(args[0].kind() != Value::V_NULL);
+}
+
+Value system_append(Arguments args) {
+    expect(args[0], Value::V_ARRAY);
+    auto arr = (Array*) args[0].object();
+    arr->elements.push_back(args[1]);
+    return arr;
+}
+
+Value system_load_file(Arguments args) {
+    return new String(MappedFile::open(args[0].str()));
+}
+
+Value system_input(Arguments args) {
+    system_print(args);
+    std::string s;
+    std::getline(std::cin, s);
+    return new String(s);
+}
+
+Value system_length(Arguments args) {
+    if (args.size() != 1) {
+        std::cout << "InterpreSystemBuildInFunction 'Length' Needs 1 value\n";
+        exit(-1);
+    }
+    auto tmp = args[0];
+    if (tmp.kind() == Value::V_STRING) return Value::from_int((long long)string_of(tmp).size());
+    if (tmp.kind() == Value::V_ARRAY) return Value::from_int((long long)((Array*)tmp.object())->elements.size());
+    std::cout << "TypeError: need a string or array\n";
+    exit(-1);
+}
 
-class ModuleManager {
-public:
-    std::unordered_map<std::string, int> count;
+Value system_str_to_int(Arguments args) {
+    if (args.size() != 1) {
+        std::cout << "InterpreSystemBuildInFunction 'Length' Needs 1 value\n";
+        exit(-1);
+    }
+    return Value::from_int(std::stoll(args[0].str()));
+}
 
-    bool is_import(std::string path) {
-        return count.find(path) != count.end();
+Value system_int_to_str(Arguments args) {
+    if (args.size() != 1) {
+        std::cout << "InterpreSystemBuildInFunction 'Length' Needs 1 value\n";
+        exit(-1);
     }
+    return new String(args[0].str());
+}
 
-    void regist(std::string name) {
-        count[name] = 1;
+Value system_str_to_flo(Arguments args) {
+    if (args.size() != 1) {
+        std::cout << "InterpreSystemBuildInFunction 'Length' Needs 1 value\n";
+        exit(-1);
     }
-};
+    return Value::from_float(std::stod(args[0].str()));
+}
 
-class Interpreter {
-public:
-    Interpreter(std::string fn_name, std::vector<AST*> opers, ModuleManager *mg, Context* context = nullptr) {
-        this->opers = opers;
-        this->global = (context)? context: new Context("<Program>");
-        this->mg = mg;
-        this->execute_result = new Null();
-        if (!global->is_have_std) setup_build_in_functions();
-        execute_all();
+Value system_flo_to_str(Arguments args) {
+    if (args.size() != 1) {
+        std::cout << "InterpreSystemBuildInFunction 'Length' Needs 1 value\n";
+        exit(-1);
     }
+    return new String(args[0].str());
+}
+
+void setup_build_in_functions(Context* root) {
+    root->is_have_std = true;
+    root->add("Print", new BuildInFunctions("print", system_print));
+    root->add("Println", new BuildInFunctions("println", system_println));
+    root->add("StringToInt", new BuildInFunctions("StringToInt", system_str_to_int));
+    root->add("IntToString", new BuildInFunctions("system_int_to_str", system_int_to_str));
+    root->add("FloatToString", new BuildInFunctions("system_flo_to_str", system_flo_to_str));
+    root->add("StringToFloat" ,new BuildInFunctions("system_str_to_flo", system_str_to_flo));
+    root->add("Length", new BuildInFunctions("Length", system_length));
+    root->add("Input", new BuildInFunctions("Input", system_input));
+    root->add("Append", new BuildInFunctions("Append", system_append));
+    root->add("NotNull", new BuildInFunctions("NotNull", system_not_null));
+    root->add("Read", new BuildInFunctions("Read", system_load_file));
+}
+
+
+// A resolved assignment target: a variable slot, an object member or an element
+// of an array/string. Reads and writes go straight to the underlying storage.
+struct LValue {
+    enum Kind { L_SLOT, L_MEMBER, L_ELEMENT } kind;
+    Context* scope = nullptr;
+    int slot = 0;
+    BasicObject* object = nullptr;
+    std::string_view member = {};
+    Object* container = nullptr;
+    Value position = Value::null();
 
-    Interpreter(std::string fn_name, Context* context = nullptr) {
-        this->global = (context)? context: new Context("<Program>");
-        this->execute_result = new Null();
-        if (!global->is_have_std) setup_build_in_functions();
+    static LValue of_slot(Context* scope, int slot) {
+        LValue lv{L_SLOT};
+        lv.scope = scope, lv.slot = slot;
+        return lv;
     }
 
-    ModuleManager* mg;
+    static LValue of_member(BasicObject* object, std::string_view member) {
+        LValue lv{L_MEMBER};
+        lv.object = object, lv.member = member;
+        return lv;
+    }
 
-    Value* execute_result;
-    Context* global;
+    static LValue of_element(Object* container, Value position) {
+        LValue lv{L_ELEMENT};
+        lv.container = container, lv.position = position;
+        return lv;
+    }
 
-    void execute_all() {
-        for (auto i : opers) {
-            auto tmp = visit_node(i);
-            if (tmp->kind == Value::V_FUNC)
-                global->add(((Function*)tmp)->name, tmp);
-            if (tmp->kind == Value::V_RT_RESULT) {
-                auto t = (RTResult*) tmp;
-                if (t->kind == RTResult::S_RETURN)
-                    return;
-            }
+    // Keeps the referenced container alive while the assigned value is evaluated.
+    inline void pin() const {
+        if (kind == L_MEMBER) heap.pin(object);
+        else if (kind == L_ELEMENT) heap.pin(container);
+    }
+
+    inline Value get() const {
+        switch (kind) {
+            case L_SLOT: return scope->slots[slot];
+            case L_MEMBER: return object->get(member);
+            default: return container->element_get(position);
         }
     }
 
-    void setup_build_in_functions() {
-        global->is_have_std = true;
-        global->add("Print", new BuildInFunctions("print", &Interpreter::system_print));
-        global->add("Println", new BuildInFunctions("println", &Interpreter::system_println));
-        global->add("StringToInt", new BuildInFunctions("StringToInt", &Interpreter::system_str_to_int));
-        global->add("IntToString", new BuildInFunctions("system_int_to_str", &Interpreter::system_int_to_str));
-        global->add("FloatToString", new BuildInFunctions("system_flo_to_str", &Interpreter::system_flo_to_str));
-        global->add("StringToFloat" ,new BuildInFunctions("system_str_to_flo", &Interpreter::system_str_to_flo));
-        global->add("Length", new BuildInFunctions("Length", &Interpreter::system_length));
-        global->add("Input", new BuildInFunctions("Input", &Interpreter::system_input));
-        global->add("Append", new BuildInFunctions("Append", &Interpreter::system_append));
-        global->add("NotNull", new BuildInFunctions("NotNull", &Interpreter::system_not_null));
-        global->add("Read", new BuildInFunctions("Read", &Interpreter::system_load_file));
+    inline void set(Value value) const {
+        switch (kind) {
+            case L_SLOT: scope->slots[slot] = value; break;
+            case L_MEMBER: object->set(member, value); break;
+            default: container->element_set(position, value);
+        }
     }
-private:
-    std::vector<AST*> opers;
+};
+
+// How a statement finished; the value of a `return` is kept in the current Frame.
+enum Completion { C_NORMAL, C_BREAK, C_CONTINUE, C_RETURN };
+
+// Activation record of a user function call; the call's own scopes chain off
+// the context created for it, and the caller's scope and module are restored on
+// return.
+struct Frame {
+    Function* function;
+    Context* caller_scope;
+    FlatAST* caller_code;
+    Value result;
+};
+
+// Registry of the program and imported modules; owns each one's flat AST.
+// Import paths are string literals, so preload() can find the modules imported
+// at top level before the program runs and parse them all at once on a thread
+// pool; a module found while parsing another is queued as soon as its importer
+// is done. Imports inside functions or branches may never run and are left to
+// load(), which hands over the ready AST when execution reaches the import, or
+// parses it on the spot if it was not preloaded.
+class ModuleManager {
+public:
+    std::unordered_map<std::string, FlatAST*> modules;
 
-    inline void create_scope(std::string name) {
-        global = new Context(name, global);
+    ~ModuleManager() {
+        for (auto& i : modules) delete i.second;
+        for (auto& i : parsed) delete i.second;
     }
 
-    inline void leave_scope() {
-        if (global->parent_context)
-            global = global->parent_context;
+    bool is_import(std::string path) {
+        return modules.find(path) != modules.end();
     }
 
-    inline Value* system_not_null(std::vector<Value*> args) {
-        return new Bool(args[0]->kind != Value::V_NULL);
+    void regist(std::string name, FlatAST* ast = nullptr) {
+        modules[name] = ast;
     }
 
-    Value* system_append(std::vector<Value*> args) {
-        auto arr = (Array*) args[0];
-        arr->elements.push_back(args[1]);
-        return arr;
+    // Parses the modules `program` imports at top level, and theirs, and waits for
+    // all of them. A parse error is only reported if load() asks for the module.
+    void preload(const FlatAST& program) {
+        std::vector<std::string> paths = imports(program);
+        if (paths.empty()) return;
+        std::unique_lock<std::mutex> guard(lock);
+        queue(paths);
+        done.wait(guard, [this] { return outstanding == 0; });
+        guard.unlock();
+        pool.reset();
     }
 
-    Value* system_load_file(std::vector<Value*> args) {
-        std::string data, buffer;
-        std::ifstream ifs(((String*)args[0])->basicString);
-        while (std::getline(ifs, buffer))
-            data += buffer + '\n';
-        return new String(data);
+    // The AST of a module about to be imported, parsed now if preload() did not.
+    FlatAST* load(const std::string& path) {
+        auto failed = errors.find(path);
+        if (failed != errors.end()) parse_error(failed->second);
+        auto found = parsed.find(path);
+        if (found == parsed.end() || !found->second) return parse_file(path);
+        FlatAST* ast = found->second;
+        parsed.erase(found);
+        return ast;
     }
 
-    Value* system_input(std::vector<Value*> args) {
-        system_print(args);
-        std::string s;
-        std::getline(std::cin, s);
-        return new String(s);
+private:
+    std::unordered_map<std::string, FlatAST*> parsed; // preloaded, not yet imported
+    std::unordered_map<std::string, std::string> errors; // preloads that failed to parse
+    std::unique_ptr<ThreadPool> pool;
+    std::mutex lock;
+    std::condition_variable done;
+    size_t outstanding = 0;
+
+    static std::vector<std::string> imports(const FlatAST& ast) {
+        std::vector<std::string> paths;
+        for (auto n : ast.statements())
+            if (ast.kind(n) == AST::A_IMPORT) paths.emplace_back(ast.text(ast.at(n).a));
+        return paths;
+    }
+
+    // Called with `lock` held.
+    void queue(const std::vector<std::string>& paths) {
+        for (auto& path : paths) {
+            if (!parsed.emplace(path, nullptr).second) continue;
+            if (!pool) pool = std::make_unique<ThreadPool>();
+            ++outstanding;
+            pool->submit([this, path] {
+                FlatAST* ast = nullptr;
+                std::string error;
+                parse_errors_throw = true;
+                try { ast = parse_file(path); } catch (ParseError& e) { error = e.message; }
+                parse_errors_throw = false;
+                std::lock_guard<std::mutex> guard(lock);
+                if (ast) parsed[path] = ast, queue(imports(*ast));
+                else errors[path] = error;
+                if (--outstanding == 0) done.notify_all();
+            });
+        }
     }
+};
 
-    Value* system_length(std::vector<Value*> args) {
-        if (args.size() != 1) {
-            std::cout << "InterpreSystemBuildInFunction 'Length' Needs 1 value\n";
-            exit(-1);
+class Interpreter {
+public:
+    Interpreter(std::string fn_name, FlatAST* program, ModuleManager *mg, Context* context = nullptr) {
+        this->global = (context)? context: new Context(fn_name);
+        this->root = global->get_global();
+        this->mg = mg;
+        enter(program);
+        mg->regist(fn_name, program);
+        mg->preload(*program);
+        this->frames.push_back({nullptr, nullptr, nullptr, Value::null()});
+        if (!root->is_have_std) setup_build_in_functions(root);
+        execute_all(program->statements());
+    }
+
+    ModuleManager* mg;
+
+    Context* global;
+    Context* root;
+    FlatAST* code; // module being executed, see enter()
+    std::vector<Frame> frames;
+
+    void collect_garbage() {
+        for (Context* c = global; c; c = c->parent_context) heap.mark_all(c->slots);
+        for (auto& frame : frames) {
+            if (frame.function) heap.mark(frame.function);
+            heap.mark(frame.result);
+            for (Context* c = frame.caller_scope; c; c = c->parent_context) heap.mark_all(c->slots);
         }
-        auto tmp = args[0];
-        if (tmp->kind == Value::V_STRING) return new Integer(std::to_string(((String*)tmp)->basicString.size()));
-        if (tmp->kind == Value::V_ARRAY) return new Integer(std::to_string(((Array*)tmp)->elements.size()));
-        std::cout << "TypeError: need a string or array\n";
-        exit(-1);
+        heap.collect();
     }
 
-    Value* system_print(std::vector<Value*> args) {
-        for (auto i : args)
-            std::cout << i->str();
-        return new Null();
+    void execute_all(NodeList opers) {
+        for (auto i : opers)
+            if (execute(i) == C_RETURN)
+                return;
     }
+private:
+    // Arrays of `code`, kept at hand since every visit reads them.
+    const uint8_t* kinds = nullptr;
+    FlatAST::Operands* nodes = nullptr;
+    const long long* ints = nullptr;
+    const double* floats = nullptr;
 
-    Value* system_println(std::vector<Value*> args) {
-        system_print(args);
-        printf("\n");
-        return new Null();
+    inline void enter(FlatAST* module) {
+        code = module;
+        kinds = module->kinds.data();
+        nodes = module->operands.data();
+        ints = module->ints.data();
+        floats = module->floats.data();
     }
 
-    Value* system_str_to_int(std::vector<Value*> args) {
-        if (args.size() != 1) {
-            std::cout << "InterpreSystemBuildInFunction 'Length' Needs 1 value\n";
-            exit(-1);
-        }
-        return new Integer(((Integer*)args[0])->number);
+    inline AST::AKind kind(NodeRef n) const { return (AST::AKind)kinds[n]; }
+
+    inline FlatAST::Operands& at(NodeRef n) const { return nodes[n]; }
+
+    inline void create_scope(std::string name, int size) {
+        global = new Context(name, global, size);
     }
 
-    Value* system_int_to_str(std::vector<Value*> args) {
-        if (args.size() != 1) {
-            std::cout << "InterpreSystemBuildInFunction 'Length' Needs 1 value\n";
-            exit(-1);
+    // Root-level names are looked up by name once; the slot is then cached on the node.
+    Value& global_slot(std::string_view name, int& cache) {
+        if (cache < 0) {
+            cache = root->find(std::string(name));
+            if (cache < 0) root->not_defined(std::string(name));
         }
-        return new Integer(((String*)args[0])->basicString);
+        return root->slots[cache];
     }
 
-    Value* system_str_to_flo(std::vector<Value*> args) {
-        if (args.size() != 1) {
-            std::cout << "InterpreSystemBuildInFunction 'Length' Needs 1 value\n";
-            exit(-1);
-        }
-        return new String(((Float*)args[0])->number);
+    // An A_ID node: (name, depth, slot).
+    Value& variable(NodeRef id) {
+        FlatAST::Operands& op = at(id);
+        if (op.b == IdNode::GLOBAL) return (op.c >= 0)? root->slots[op.c] : global_slot(code->text(op.a), op.c);
+        Context* c = global->up(op.b);
+        if (c->slots[op.c].is_undefined()) c->not_defined(std::string(code->text(op.a)));
+        return c->slots[op.c];
     }
 
-    Value* system_flo_to_str(std::vector<Value*> args) {
-        if (args.size() != 1) {
-            std::cout << "InterpreSystemBuildInFunction 'Length' Needs 1 value\n";
+    inline void leave_scope() {
+        Context* scope = global;
+        global = scope->parent_context;
+        delete scope;
+    }
+
+    Value call_user_function(UserDefineFunction* fn, std::string name, Value self, std::vector<Value>& args) {
+        if (args.size() != fn->args.size()) {
+            std::cout << "Function '" << name << "' need " << fn->args.size() << " values\n";
             exit(-1);
         }
-        return new Float(((String*)args[0])->basicString);
+        frames.push_back({fn, global, code, Value::null()});
+        global = new Context(name, root, fn->frame_size);
+        global->slots[0] = self;
+        for (size_t i = 0; i < args.size(); ++i)
+            global->slots[i + 1] = args[i];
+        enter(fn->code);
+        execute_all(code->list(at(fn->body).a));
+        delete global;
+        Frame& frame = frames.back();
+        global = frame.caller_scope;
+        enter(frame.caller_code);
+        Value result = frame.result;
+        frames.pop_back();
+        return result;
     }
 
     void import_module(std::string path) {
-        std::string data, buffer;
-        std::ifstream ifs(path);
-        while (std::getline(ifs, buffer))
-            data += buffer + '\n';
-        Lexer lexer(data);
-        Parser parser(lexer.tokens);
-        auto ip = new Interpreter("<Module>", parser.ast, mg, this->global);
-    }
-
-    void visit_import(AST* a) {
-        auto path = ((ImportNode*) a)->path;
+        FlatAST* module = mg->load(path);
+        mg->regist(path, module);
+        // The importer's scope is a GC root while the module runs in the root.
+        frames.push_back({nullptr, global, code, Value::null()});
+        global = root, enter(module);
+        execute_all(module->statements());
+        global = frames.back().caller_scope, enter(frames.back().caller_code);
+        frames.pop_back();
+    }
+
+    void visit_import(NodeRef n) {
+        std::string path(code->text(at(n).a));
         if (!mg->is_import(path)) mg->regist(path), import_module(path);
     }
 
-    Value* visit_node(AST* a) {
-        switch (a->kind) {
-            case AST::A_IF: return visit_if(a);
-            case AST::A_BLOCK: return visit_block(a);
-            case AST::A_ARRAY: case AST::A_STRING: case AST::A_INT: case AST::A_FLO: case AST::A_TRUE: case AST::A_FALSE: return visit_value(a);
-            case AST::A_WHILE: return visit_while(a);
-            case AST::A_FOR: return visit_for(a);
-            case AST::A_CLASS: visit_class(a); break;
-            case AST::A_RETURN: return visit_return(a);
-            case AST::A_BREAK: return visit_break();
-            case AST::A_CONTINUE: return visit_continue();
-            case AST::A_BIN_OP: return visit_bin_op(a);
-            case AST::A_IMPORT: visit_import(a); break;
-            case AST::A_BIT_NOT: return visit_bit_not(a);
-            case AST::A_MEMBER_ACCESS: return visit_member_access(a);
-            case AST::A_ID: return visit_member_access(a);
-            case AST::A_ELEMENT_GET: return visit_element_get(a);
-            case AST::A_CALL: return visit_call(a);
-            case AST::A_NOT: return visit_not(a);
-            case AST::A_SELF_INC: return visit_self_inc(a);
-            case AST::A_SELF_DEC: return visit_self_dec(a);
-            case AST::A_VAR_DEF: visit_var_define(a); break;
-            case AST::A_FUNC_DEFINE: return visit_function(a);
-            case AST::A_SELF_OPERA: visit_self_opera(a); break;
-            case AST::A_MEM_MALLOC: return visit_memory_malloc(a);
+    Completion execute(NodeRef n) {
+        if (heap.should_collect()) collect_garbage();
+        switch (kind(n)) {
+            case AST::A_IF: return visit_if(n);
+            case AST::A_BLOCK: return visit_block(n);
+            case AST::A_WHILE: return visit_while(n);
+            case AST::A_FOR: return visit_for(n);
+            case AST::A_RETURN: return visit_return(n);
+            case AST::A_BREAK: return C_BREAK;
+            case AST::A_CONTINUE: return C_CONTINUE;
+            case AST::A_CLASS: visit_class(n); break;
+            case AST::A_IMPORT: visit_import(n); break;
+            case AST::A_FUNC_DEFINE: {
+                auto fn = visit_function(n);
+                root->add(((Function*)fn.object())->name, fn);
+                break;
+            }
+            default: visit_node(n);
+        }
+        return C_NORMAL;
+    }
+
+    Value visit_node(NodeRef n) {
+        switch (kind(n)) {
+            case AST::A_ARRAY: case AST::A_STRING: case AST::A_INT: case AST::A_FLO: case AST::A_TRUE: case AST::A_FALSE: return visit_value(n);
+            case AST::A_BIN_OP: return visit_bin_op(n);
+            case AST::A_LAMBDA: return visit_lambda_node(n);
+            case AST::A_BIT_NOT: return visit_bit_not(n);
+            case AST::A_MEMBER_ACCESS: return visit_member_access(n);
+            case AST::A_ID: return visit_member_access(n);
+            case AST::A_ELEMENT_GET: return visit_element_get(n);
+            case AST::A_CALL: return visit_call(n);
+            case AST::A_NOT: return visit_not(n);
+            case AST::A_NEG: return visit_neg(n);
+            case AST::A_SELF_INC: return visit_self_inc(n);
+            case AST::A_SELF_DEC: return visit_self_dec(n);
+            case AST::A_VAR_DEF: visit_var_define(n); break;
+            case AST::A_FUNC_DEFINE: return visit_function(n);
+            case AST::A_SELF_OPERA: visit_self_opera(n); break;
+            case AST::A_MEM_MALLOC: return visit_memory_malloc(n);
             case AST::A_NULL: return visit_null();
             default:
-                printf("Operator '%d' not suppose\n", a->kind);
+                printf("Operator '%d' not suppose\n", kind(n));
                 exit(-1);
         }
-        return new Null();
+        return Value::null();
     }
 
-    inline Value* visit_null() { return new Null(); }
+    inline Value visit_null() { return Value::null(); }
 
-    LValue visit_lvalue(AST* a) {
-        if (a->kind == AST::A_ID) {
-            std::string name = ((IdNode*)a)->id;
-            return {
-                    [this, name]() -> Value* { return global->get(name); },
-                    [this, name](Value* val) { global->set(name, val); }
-            };
+    LValue visit_lvalue(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        if (kind(n) == AST::A_ID) {
+            variable(n);
+            return LValue::of_slot((op.b == IdNode::GLOBAL)? root : global->up(op.b), op.c);
         }
-        else if (a->kind == AST::A_MEMBER_ACCESS) {
-            MemberAccessNode* man = (MemberAccessNode*)a;
-            std::string member = man->member;
-            Value* parent_val = visit_member_access(man->parent);
-            if (parent_val->kind != Value::V_OBJECT && parent_val->kind != Value::V_ARRAY) {
+        else if (kind(n) == AST::A_MEMBER_ACCESS) {
+            Value parent_val = visit_member_access(op.a);
+            if (parent_val.kind() != Value::V_OBJECT && parent_val.kind() != Value::V_ARRAY) {
                 std::cout << "Member access on non-object\n";
                 exit(-1);
             }
-            BasicObject* obj = (BasicObject*)parent_val;
-            return {
-                    [obj, member]() -> Value* { return obj->get(member); },
-                    [obj, member](Value* val) { obj->set(member, val); }
-            };
+            return LValue::of_member((BasicObject*)parent_val.object(), code->text(op.b));
         }
-        else if (a->kind == AST::A_ELEMENT_GET) {
-            ElementGetNode* egn = (ElementGetNode*)a;
-            Value* arr_val = visit_member_access(egn->array_name);
-            Value* pos_val = visit_value(egn->position);
-            if (pos_val->kind != Value::V_INT) {
+        else if (kind(n) == AST::A_ELEMENT_GET) {
+            Value arr_val = visit_member_access(op.a);
+            Heap::PinScope pins;
+            heap.pin(arr_val);
+            Value pos_val = visit_value(op.b);
+            if (pos_val.kind() != Value::V_INT) {
                 std::cout << "Index must be integer\n";
                 exit(-1);
             }
-            int pos = std::stoi(((Integer*)pos_val)->number);
-            if (arr_val->kind == Value::V_ARRAY) {
-                Array* arr = (Array*)arr_val;
-                return {
-                        [arr, pos]() -> Value* { return arr->elements[pos]; },
-                        [arr, pos](Value* val) { arr->elements[pos] = val; }
-                };
-            } else if (arr_val->kind == Value::V_STRING) {
-                String* str = (String*)arr_val;
-                return {
-                        [str, pos]() -> Value* {
-                            std::string res;
-                            res += str->basicString[pos];
-                            return new String(res);
-                        },
-                        [str, pos](Value* val) {
-                            if (val->kind != Value::V_STRING) {
-                                std::cout << "Can only assign char to string element\n";
-                                exit(-1);
-                            }
-                            str->basicString[pos] = ((String*)val)->basicString[0];
-                        }
-                };
-            } else {
+            if (arr_val.kind() != Value::V_ARRAY && arr_val.kind() != Value::V_STRING) {
                 std::cout << "Cannot element-get on non-array/string\n";
                 exit(-1);
             }
+            return LValue::of_element(arr_val.object(), pos_val);
         } else {
             std::cout << "Expression cannot be used as lvalue\n";
             exit(-1);
         }
     }
 
-    Value* visit_memory_malloc(AST* a) {
-        auto cnode = (MemoryMallocNode*) a;
-        auto cname = cnode->name;
-        auto args = cnode->args;
-        auto obj = (BasicObject*)(global->get(cname)->copy());
+    Value visit_memory_malloc(NodeRef n) {
+        FlatAST::Operands& op = at(n);
+        std::string cname(code->text(op.a));
+        auto obj = (BasicObject*)global_slot(cname, op.c).copy().object();
         auto constructor_val = obj->get_constructor();
-        if (!cnode->is_call_c) { return obj; }
-        if (constructor_val->kind != Value::V_FUNC) {
+        if (op.b == NO_NODE) { return obj; }
+        NodeList args = code->list(op.b);
+        if (constructor_val.kind() != Value::V_FUNC) {
             std::cout << "Constructor is not a function\n";
             exit(-1);
         }
-        UserDefineFunction* constructor = (UserDefineFunction*)constructor_val;
-        auto ctemplate = constructor->args;
-        if (args.size() != ctemplate.size()) {
-            std::cout << cname + "$constructor need " << ctemplate.size() << " values but find " << args.size() << "\n";
+        UserDefineFunction* constructor = (UserDefineFunction*)constructor_val.object();
+        if (args.size() != constructor->args.size()) {
+            std::cout << cname + "$constructor need " << constructor->args.size() << " values but find " << args.size() << "\n";
             exit(-1);
         }
-        Context* c = new Context("Context", global->get_global());
-        c->add("this", obj);
-        for (int i = 0; i < ctemplate.size(); ++i) c->add(ctemplate[i], visit_value(args[i]));
-        auto ip = new Interpreter(cname + "$constructor", constructor->body, mg, c);
+        Heap::PinScope pins;
+        heap.pin(obj);
+        std::vector<Value> values;
+        for (auto i : args) values.push_back(visit_value(i)), heap.pin(values.back());
+        call_user_function(constructor, cname + "$constructor", obj, values);
         return obj;
     }
 
-    Value* visit_self_opera(AST* a) {
-        auto sp = (SelfOperator*) a;
-        std::string op = sp->op;
-        LValue lv = visit_lvalue(sp->target);
-        Value* val = visit_value(sp->value);
-        if (op == "=") {
-            lv.setter(val->copy());
-        } else {
-            Value* current = lv.getter();
-            Value* result = nullptr;
-            if (op == "+=") result = current->add(val);
-            else if (op == "-=") result = current->sub(val);
-            else if (op == "*=") result = current->mul(val);
-            else if (op == "/=") result = current->div(val);
-            else if (op == ">>=") result = current->right_move(val);
-            else if (op == "<<=") result = current->left_move(val);
-            else if (op == "%=") result = current->mod(val);
-            else {
-                std::cout << "Unknown self operator: " << op << std::endl;
-                exit(-1);
-            }
-            lv.setter(result);
-        }
-        return new Null();
-    }
-
-    Value* visit_var_define(AST* a) {
-        auto n = (VarDefineNode*) a;
-        std::string name = n->name;
-        Value* init_val = (n->init_value)? visit_value(n->init_value): new Null();
-        global->add(name, init_val);
-        return new Null();
-    }
-
-    Value* visit_self_inc(AST* a) {
-        auto tmp = (SelfIncNode*) a;
-        LValue lv = visit_lvalue(tmp->id);
-        Value* current = lv.getter();
-        Value* one = new Float("1.0");
-        if (tmp->ipre == pre) {
-            Value* new_val = current->add(one);
-            lv.setter(new_val);
-            return new_val->copy();
-        } else {
-            Value* old_copy = current->copy();
-            Value* new_val = current->add(one);
-            lv.setter(new_val);
-            return old_copy;
-        }
-    }
-
-    Value *visit_self_dec(AST* a) {
-        auto tmp = (SelfIncNode*) a;
-        LValue lv = visit_lvalue(tmp->id);
-        Value* current = lv.getter();
-        Value* one = new Float("1.0");
-        if (tmp->ipre == pre) {
-            Value* new_val = current->sub(one);
-            lv.setter(new_val);
-            return new_val->copy();
+    Value visit_self_opera(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        LValue lv = visit_lvalue(op.a);
+        Heap::PinScope pins;
+        lv.pin();
+        Value val = visit_value(op.b);
+        if (op.c == OP_COUNT) {
+            lv.set(val.copy());
         } else {
-            Value* old_copy = current->copy();
-            Value* new_val = current->sub(one);
-            lv.setter(new_val);
-            return old_copy;
+            Value current = lv.get();
+            lv.set(binary_operation((Operator)op.c, current, val));
         }
+        return Value::null();
     }
 
-    Value* visit_block(AST* a) {
-        auto bn = (Block*) a;
-        for (auto i : bn->codes) {
-            auto _res = visit_node(i);
-            if (_res->kind == Value::V_RT_RESULT) {
-                auto res = (RTResult*) _res;
-                if (res->kind == RTResult::S_BREAK || res->kind == RTResult::S_CONTINUE ||
-                    res->kind == RTResult::S_RETURN)
-                    return res;
-            }
-        }
-        return new RTResult(RTResult::S_NONE);
+    Value visit_var_define(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        Value init_val = (op.b != NO_NODE)? visit_value(op.b): Value::null();
+        if (op.c < 0) root->add(std::string(code->text(op.a)), init_val);
+        else global->slots[op.c] = init_val;
+        return Value::null();
     }
 
-    Value* visit_return(AST* a) {
-        auto ret = (ReturnNode*)a ;
-        this->execute_result = (ret->value)? visit_value(ret->value) : new Null();
-        return new RTResult(RTResult::S_RETURN);
+    Value visit_self_inc(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        LValue lv = visit_lvalue(op.a);
+        Value current = lv.get();
+        Value new_val = binary_operation(OP_ADD, current, Value::from_int(1));
+        lv.set(new_val);
+        return (op.b == pre)? new_val : current;
     }
 
-    Value *visit_break() { return new RTResult(RTResult::S_BREAK); }
-
-    Value* visit_continue() { return new RTResult(RTResult::S_CONTINUE); }
-
-    Value *visit_bit_not(AST* a) { return visit_value(a)->bit_not(); }
-
-    Value* visit_not(AST* a) { return visit_value(((NotNode*)a)->expr)->cond_not(); }
-
-    Value* visit_element_get(AST* a) {
-        auto tmp = (ElementGetNode*) a;
-        auto id  = visit_member_access(tmp->array_name);
-        auto pos = visit_value(tmp->position);
-        return id->element_get(pos);
+    Value visit_self_dec(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        LValue lv = visit_lvalue(op.a);
+        Value current = lv.get();
+        Value new_val = binary_operation(OP_SUB, current, Value::from_int(1));
+        lv.set(new_val);
+        return (op.b == pre)? new_val : current;
     }
 
-    Value* visit_call(AST* a) {
-        auto call_node = (CallNode*) a;
-        auto fn_id = call_node->func_name;
-        std::vector<Value*> args;
-        for (auto i : call_node->args) args.push_back(visit_value(i));
-        auto body = (Function*)visit_member_access(fn_id);
-        std::string name = (fn_id->kind == AST::A_MEMBER_ACCESS)? ((MemberAccessNode*)fn_id)->member : ((IdNode*)fn_id)->id;
-        auto c = new Context(name ,global->get_global());
-        if (fn_id->kind == AST::A_MEMBER_ACCESS) {
-            auto object_point = visit_member_access(((MemberAccessNode *) fn_id)->parent);
-            c->add("this", object_point);
+    Completion visit_block(NodeRef n) {
+        for (auto i : code->list(at(n).a)) {
+            Completion res = execute(i);
+            if (res != C_NORMAL) return res;
         }
+        return C_NORMAL;
+    }
+
+    Completion visit_return(NodeRef n) {
+        NodeRef value = at(n).a;
+        Value result = (value != NO_NODE)? visit_value(value) : Value::null();
+        frames.back().result = result;
+        return C_RETURN;
+    }
+
+    Value visit_bit_not(NodeRef n) { return op_bit_not(visit_value(at(n).a)); }
+
+    Value visit_not(NodeRef n) { return op_cond_not(visit_value(at(n).a)); }
+
+    Value visit_neg(NodeRef n) { return op_neg(visit_value(at(n).a)); }
+
+    Value visit_element_get(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        auto id  = visit_member_access(op.a);
+        Heap::PinScope pins;
+        heap.pin(id);
+        auto pos = visit_value(op.b);
+        return heap_operand(id, "[]")->element_get(pos);
+    }
+
+    Value visit_call(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        NodeRef fn_id = op.a;
+        std::vector<Value> args;
+        Heap::PinScope pins;
+        for (auto i : code->list(op.b)) args.push_back(visit_value(i)), heap.pin(args.back());
+        // The receiver is evaluated once: the method is looked up on it and it is passed as `this`.
+        bool is_method = kind(fn_id) == AST::A_MEMBER_ACCESS;
+        Value self = (is_method)? visit_member_access(at(fn_id).a) : Value::undefined();
+        heap.pin(self);
+        auto callee = (is_method)? member_of(self, fn_id) : visit_member_access(fn_id);
+        expect(callee, Value::V_FUNC);
+        heap.pin(callee);
+        auto body = (Function*)callee.object();
+        if (body->fun_kind == Function::F_BUILD_IN)
+            return ((BuildInFunctions*)body)->__call__({args.data(), (int)args.size()});
         if (body->fun_kind == Function::F_USER_DEFINE) {
-            auto temp = (UserDefineFunction*) body;
-            auto args_t = temp->args;
-            if (args.size() != args_t.size()) {
-                std::cout << "Function '" << name << "' need " << args_t.size() << " values\n";
-                throw std::exception();
-            }
-            for (int i = 0; i < args_t.size(); ++i)
-                c->add(args_t[i], args[i]);
-            auto interpreter = new Interpreter(name, temp->body, mg, c);
-            return interpreter->execute_result;
-        } else if (body->fun_kind == Function::F_BUILD_IN) {
-            auto temp = (BuildInFunctions*) body;
-            auto nip = new Interpreter(name, c);
-            return temp->__call__(nip, args);
-        }
-        return new Null();
-    }
-
-    Value* visit_if(AST* a) {
-        create_scope("<If>");
-        auto in = (IfNode*) a;
-        if (((Bool*) visit_value(in->condition))->b) {
-            auto tmp = visit_block(in->if_true);
-            leave_scope();
-            return tmp;
-        } else if (in->if_false) {
-            auto tmp = visit_block(in->if_false);
-            leave_scope();
-            return tmp;
+            std::string name(code->text((is_method)? at(fn_id).b : at(fn_id).a));
+            return call_user_function((UserDefineFunction*)body, name, self, args);
         }
-        leave_scope();
-        return new RTResult(RTResult::S_NONE);
+        return Value::null();
     }
 
-    Value* visit_function(AST* a) {
-        auto fnode = (FunctionNode*) a;
-        std::vector<std::string> args;
-        for (auto i : fnode->args) args.push_back(((VarDefineNode*)i)->name);
-        auto d = new UserDefineFunction(fnode->name, args, ((Block*)fnode->body)->codes);
-        return d;
+    Completion visit_if(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        NodeRef branch = (visit_value(op.a).as_bool())? op.b : op.c;
+        if (branch == NO_NODE) return C_NORMAL;
+        create_scope("<If>", at(branch).b);
+        auto tmp = visit_block(branch);
+        leave_scope();
+        return tmp;
     }
 
-    Value* visit_for(AST* a) {
-        create_scope("<For-Loop-Condition>");
-        auto for_node = (ForNode*) a;
-        auto init = for_node->init;
-        visit_var_define(init);
-        auto is_loop = (Bool*)visit_value(for_node->is_continue);
-        auto change = for_node->change;
-        auto body = ((Block*)for_node->body);
-        while (is_loop->b) {
-            create_scope("<For-Loop-Frame>");
-            auto res = visit_block(body);
-            leave_scope();
-            if (res->kind == Value::V_RT_RESULT) {
-                auto tmp = (RTResult*) res;
-                if (tmp->kind == RTResult::S_CONTINUE) continue;
-                if (tmp->kind == RTResult::S_BREAK) break;
-                if (tmp->kind == RTResult::S_RETURN) return tmp;
-            }
+    std::vector<std::string> parameter_names(NodeList params) {
+        std::vector<std::string> args;
+        for (auto i : params) args.emplace_back(code->text(at(i).a));
+        return args;
+    }
+
+    Value visit_function(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        return new UserDefineFunction(std::string(code->text(op.a)), parameter_names(code->list(op.b)), code, op.c);
+    }
+
+    // A loop allocates its body frame once and clears it between iterations.
+    Completion run_loop_body(Context* frame, NodeRef body) {
+        global = frame;
+        Completion res = visit_block(body);
+        global = frame->parent_context;
+        frame->reset();
+        return res;
+    }
+
+    Completion visit_for(NodeRef n) {
+        create_scope("<For-Loop-Condition>", 1);
+        const FlatAST::Operands& op = at(n);
+        visit_var_define(op.a);
+        NodeRef change = code->extra[op.c], body = code->extra[op.c + 1];
+        Context frame("<For-Loop-Frame>", global, at(body).b);
+        Completion res = C_NORMAL;
+        while (visit_value(op.b).as_bool()) {
+            res = run_loop_body(&frame, body);
+            if (res == C_BREAK || res == C_RETURN) break;
             visit_node(change);
-            is_loop = (Bool*) visit_value(for_node->is_continue);
         }
         leave_scope();
-        return new RTResult(RTResult::S_NONE);
+        return (res == C_RETURN)? C_RETURN : C_NORMAL;
     }
 
-    void reset_scope() {
-        std::string name = global->display_name;
-        leave_scope();
-        create_scope(name);
-    }
-
-    Value* visit_while(AST* a) {
-        create_scope("<While-Loop-Condition>");
-        auto for_node = (WhileNode*) a;
-        auto is_loop = (Bool*)visit_value(for_node->condition);
-        auto body = ((Block*)for_node->body);
-        while (is_loop->b) {
-            create_scope("<While-Loop-Frame>");
-            auto res = visit_block(body);
-            leave_scope();
-            if (res->kind == Value::V_RT_RESULT) {
-                auto tmp = (RTResult*) res;
-                if (tmp->kind == RTResult::S_NONE || tmp->kind == RTResult::S_CONTINUE) continue;
-                if (tmp->kind == RTResult::S_BREAK) break;
-                if (tmp->kind == RTResult::S_RETURN) return tmp;
+    Completion visit_while(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        Context frame("<While-Loop-Frame>", global, at(op.b).b);
+        Completion res = C_NORMAL;
+        while (visit_value(op.a).as_bool()) {
+            res = run_loop_body(&frame, op.b);
+            if (res == C_BREAK || res == C_RETURN) break;
+        }
+        return (res == C_RETURN)? C_RETURN : C_NORMAL;
+    }
+
+    void visit_class(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        NodeList members = code->list(op.b);
+        std::unordered_map<std::string, Value> vals;
+        Heap::PinScope pins;
+        for (int i = 0; i < members.size(); i += 2) {
+            std::string name(code->text(members[i]));
+            NodeRef member = members[i + 1];
+            if (kind(member) != AST::A_VAR_DEF) vals[name] = visit_node(member);
+            else {
+                NodeRef init = at(member).b;
+                vals[name] = (init != NO_NODE)? visit_value(init) : Value::null();
             }
-            is_loop = (Bool*) visit_call(for_node->condition);
+            heap.pin(vals[name]);
         }
-        leave_scope();
-        return new RTResult(RTResult::S_NONE);
+        std::string name(code->text(op.a));
+        root->add(name, new BasicObject(name, vals));
     }
 
-    void visit_class(AST* a) {
-        auto cl = (ObjectNode*) a;
-        std::unordered_map<std::string, Value*> vals;
-        for (auto i : cl->members) {
-            if (i.second->kind != AST::A_VAR_DEF) vals[i.first] = visit_node(i.second);
-            else {
-                auto node = (VarDefineNode*) i.second;
-                vals[i.first] = (node->init_value)? visit_value(node->init_value) : new Null();
-            }
+    Value visit_lambda_node(NodeRef n) {
+        const FlatAST::Operands& op = at(n);
+        return new UserDefineFunction("<UserDefineSubProgram>", parameter_names(code->list(op.a)), code, op.b);
+    }
+
+    Value visit_member_access(NodeRef n) {
+        switch (kind(n)) {
+            case AST::A_ELEMENT_GET: return visit_element_get(n);
+            case AST::A_CALL: return visit_call(n);
+            case AST::A_ARRAY: return visit_array(n);
+            case AST::A_STRING: case AST::A_INT: case AST::A_FLO: return visit_value(n);
+            case AST::A_ID: return variable(n);
+            default: break;
         }
-        global->add(cl->name, new BasicObject(cl->name, vals));
+        return member_of(visit_member_access(at(n).a), n);
     }
 
-    Value* visit_lambda_node(AST* a) {
-        auto ln = (LambdaNode*) a;
-        std::vector<std::string> args;
-        for (auto i : ln->args) args.push_back(((VarDefineNode*)i)->name);
-        return new UserDefineFunction("<UserDefineSubProgram>", args, ln->body->codes);
-    }
-
-    Value* visit_member_access(AST* a) {
-        if (a->kind == AST::A_ELEMENT_GET) return visit_element_get(a);
-        if (a->kind == AST::A_CALL) return visit_call(a);
-        if (a->kind == AST::A_ARRAY) return visit_array(a);
-        if (a->kind == AST::A_STRING || a->kind == AST::A_INT || a->kind == AST::A_FLO) return visit_value(a);
-        if (a->kind == AST::A_ID) return global->get(((IdNode*)a)->id);
-        Value* parent = visit_member_access(((MemberAccessNode*)a)->parent);
-        if (parent->kind != Value::V_OBJECT && parent->kind != Value::V_ARRAY) {
+    Value member_of(Value parent, NodeRef n) {
+        if (parent.kind() != Value::V_OBJECT && parent.kind() != Value::V_ARRAY) {
             std::cout << "Member access on non-object\n";
             exit(-1);
         }
-        return ((BasicObject*)parent)->get(((MemberAccessNode*)a)->member);
+        return ((BasicObject*)parent.object())->get(code->text(at(n).b));
     }
 
-    Value* visit_array(AST* a) {
-        auto arr = (ArrayNode*) a;
-        std::vector<Value*> tmp;
-        for (auto i : arr->elements)
-            tmp.push_back(visit_value(i));
+    Value visit_array(NodeRef n) {
+        std::vector<Value> tmp;
+        Heap::PinScope pins;
+        for (auto i : code->list(at(n).a))
+            tmp.push_back(visit_value(i)), heap.pin(tmp.back());
         return new Array(tmp);
     }
 
-    Value* visit_value(AST* a) {
-        if (a->kind == AST::A_BIN_OP) return visit_bin_op(a);
-        if (a->kind == AST::A_STRING) return new String(((StringNode*)a)->str);
-        if (a->kind == AST::A_LAMBDA) return visit_lambda_node(a);
-        if (a->kind == AST::A_ID || a->kind == AST::A_MEMBER_ACCESS) return visit_member_access(a);
-        if (a->kind == AST::A_FALSE) return new Bool(false);
-        if (a->kind == AST::A_CALL) return visit_call(a);
-        if (a->kind == AST::A_NULL) return visit_null();
-        if (a->kind == AST::A_TRUE) return new Bool(true);
-        if (a->kind == AST::A_NOT) return visit_not(a);
-        if (a->kind == AST::A_ELEMENT_GET) return visit_element_get(a);
-        if (a->kind == AST::A_INT) return new Integer(((IntegerNode*)a)->number);
-        if (a->kind == AST::A_FLO) return new Float(((FloatNode*)a)->number);
-        if (a->kind == AST::A_MEM_MALLOC) return visit_memory_malloc(a);
-        if (a->kind == AST::A_ARRAY) {
-            std::vector<Value*> values;
-            for (auto i : ((ArrayNode*)a)->elements)
-                values.push_back(visit_bin_op(i));
-            return new Array(values);
-        } else {
-            std::cout << "Unknown tree: " << a->kind << "\n";
-            exit(-1);
+    Value visit_value(NodeRef n) {
+        switch (kind(n)) {
+            case AST::A_BIN_OP: return visit_bin_op(n);
+            case AST::A_STRING: return new String(std::string(code->text(at(n).a)));
+            case AST::A_LAMBDA: return visit_lambda_node(n);
+            case AST::A_ID: case AST::A_MEMBER_ACCESS: return visit_member_access(n);
+            case AST::A_FALSE: return Value::from_bool(false);
+            case AST::A_CALL: return visit_call(n);
+            case AST::A_NULL: return visit_null();
+            case AST::A_TRUE: return Value::from_bool(true);
+            case AST::A_NOT: return visit_not(n);
+            case AST::A_NEG: return visit_neg(n);
+            case AST::A_BIT_NOT: return visit_bit_not(n);
+            case AST::A_ELEMENT_GET: return visit_element_get(n);
+            case AST::A_INT: return Value::from_int(ints[at(n).a]);
+            case AST::A_FLO: return Value::from_float(floats[at(n).a]);
+            case AST::A_MEM_MALLOC: return visit_memory_malloc(n);
+            case AST::A_ARRAY: return visit_array(n);
+            default:
+                std::cout << "Unknown tree: " << kind(n) << "\n";
+                exit(-1);
         }
     }
 
-    Value* visit_bin_op(AST* a) {
-        if (a->kind != AST::A_BIN_OP)
-            return visit_value(a);
-        auto left = visit_bin_op(((BinOpNode*)a)->left);
-        auto right = visit_bin_op(((BinOpNode*)a)->right);
-        auto op = ((BinOpNode*)a)->op;
-        // ======= Comp
-        if (op == "==") return left->is_eq(right);
-        if (op == ">=") return left->big_or_eq(right);
-        if (op == "<=") return left->less_or_eq(right);
-        if (op == ">") return left->big(right);
-        if (op == "<") return left->less(right);
-        // ======= Calc
-        if (op == "+") return left->add(right);
-        if (op == "-") return left->sub(right);
-        if (op == "*") return left->mul(right);
-        if (op == "/") return left->div(right);
-        if (op == "%") return left->mod(right);
-        if (op == "&") return left->bit_and(right);
-        if (op == "|") return left->bit_or(right);
-        if (op == "<<") return left->left_move(right);
-        if (op == ">>") return left->right_move(right);
-        // ======= Condition
-        if (op == "&&") return left->cond_and(right);
-        if (op == "||") return left->cond_or(right);
-        if (op == "!=") return left->not_eq_(right);
-        std::cout << "Unknown operator '" << op << "' when the program running\n";
-        exit(-1);
+    Value visit_bin_op(NodeRef n) {
+        if (kind(n) != AST::A_BIN_OP)
+            return visit_value(n);
+        const FlatAST::Operands& op = at(n);
+        auto left = visit_bin_op(op.b);
+        Heap::PinScope pins;
+        heap.pin(left);
+        auto right = visit_bin_op(op.c);
+        return binary_operation((Operator)op.a, left, right);
     }
 };
 
-#endif
\ No newline at end of file
+#endif
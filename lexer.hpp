@@ -3,6 +3,11 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <memory>
+#include "file.hpp"
+#include "scan.hpp"
 
 struct Position {
     int lin, col;
@@ -18,146 +23,265 @@ struct Position {
     }
 };
 
+// The text being lexed and the offset at which each of its lines starts, so a
+// token only records an offset and its (lin, col) is looked up on demand.
+// "\r\n", "\n" and a lone "\r" each end one line. The text is either owned or
+// a view of a memory-mapped file that the Source keeps alive.
+struct Source {
+    std::string_view text;
+    std::vector<uint32_t> line_starts;
+
+    Source(std::string text) : owned(std::move(text)) {
+        index(owned);
+    }
+
+    Source(std::shared_ptr<MappedFile> file) : file(std::move(file)) {
+        index(this->file->view());
+    }
+
+    Source(const Source&) = delete;
+
+    Position position(uint32_t offset) const {
+        int line = (int)(std::upper_bound(line_starts.begin(), line_starts.end(), offset) - line_starts.begin());
+        return Position(line, (int)(offset - line_starts[line - 1]) + 1);
+    }
+
+private:
+    std::string owned;
+    std::shared_ptr<MappedFile> file;
+
+    void index(std::string_view view) {
+        text = view;
+        line_starts.push_back(0);
+        for (size_t i = scan::find_newline(text, 0); i < text.size(); i = scan::find_newline(text, i + 1)) {
+            if (text[i] == '\r' && i + 1 < text.size() && text[i + 1] == '\n') ++i;
+            line_starts.push_back((uint32_t)i + 1);
+        }
+    }
+};
+
+// A token is a slice of the Source it was lexed from, which must outlive it.
+// Operator tokens also carry their operator_id, so the parser can look them up
+// in a table instead of comparing text.
 struct Token {
-    std::string data;
-    enum TokenKind {
+    std::string_view data;
+    enum TokenKind : uint8_t {
         TT_INTEGER, TT_FLOAT, TT_STRING, TT_ID, TT_OP, TT_BOOL, TT_KEY
     } kind;
 
-    Position start_pos, end_pos;
+    uint16_t id;
+    uint32_t offset;
 
-    Token(std::string data, TokenKind kind, Position start_pos, Position end_pos) {
+    Token() : kind(TT_OP), id(0), offset(0) { }
+
+    Token(std::string_view data, TokenKind kind, uint32_t offset, uint16_t id = 0) {
         this->data = data;
         this->kind = kind;
-        this->start_pos = start_pos;
-        this->end_pos = end_pos;
+        this->id = id;
+        this->offset = offset;
     }
 
-    void debug() { std::cout << "('" << data << "', " << kind << "')" << start_pos.debug() << end_pos.debug(); }
+    void debug() { std::cout << "('" << data << "', " << (int)kind << "')@" << offset; }
+};
+
+// ======= Classification tables
+// Every byte is classified by one table load. Keywords and multi-character
+// operators live in 64-slot tables indexed by a multiplicative hash of (first
+// char, second char, last char, length); the multiplier was picked so that
+// neither set collides, which the static_asserts below re-check at compile time.
+
+enum CharClass : uint8_t { CC_OTHER, CC_SPACE, CC_DIGIT, CC_IDENT, CC_QUOTE, CC_COMMENT };
+
+struct CharTable {
+    CharClass classes[256];
+};
+
+constexpr CharTable make_char_table() {
+    CharTable table{};
+    for (int c = 0; c < 256; ++c) {
+        CharClass cls = CC_OTHER;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f') cls = CC_SPACE;
+        else if ('0' <= c && c <= '9') cls = CC_DIGIT;
+        else if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || c == '_') cls = CC_IDENT;
+        else if (c == '\'' || c == '"') cls = CC_QUOTE;
+        else if (c == '#') cls = CC_COMMENT;
+        table.classes[c] = cls;
+    }
+    return table;
+}
+
+constexpr CharTable char_table = make_char_table();
+
+inline CharClass char_class(char c) { return char_table.classes[(uint8_t)c]; }
+
+constexpr uint32_t PERFECT_HASH_SEED = 0x6d21f4cd;
+constexpr int PERFECT_HASH_BITS = 6;
+
+// Only defined for words of at least two characters.
+constexpr uint32_t perfect_hash(std::string_view word) {
+    uint32_t key = (uint32_t)(uint8_t)word[0] | (uint32_t)(uint8_t)word[1] << 8 |
+                   (uint32_t)(uint8_t)word[word.size() - 1] << 16 | (uint32_t)word.size() << 24;
+    return (key * PERFECT_HASH_SEED) >> (32 - PERFECT_HASH_BITS);
+}
+
+struct WordTable {
+    std::string_view words[1 << PERFECT_HASH_BITS];
+    Token::TokenKind kinds[1 << PERFECT_HASH_BITS];
+    bool perfect = true;
+
+    // Returns `fallback` when `word` is not in the table.
+    constexpr Token::TokenKind find(std::string_view word, Token::TokenKind fallback) const {
+        if (word.size() < 2) return fallback;
+        uint32_t slot = perfect_hash(word);
+        return (words[slot] == word)? kinds[slot] : fallback;
+    }
+
+    constexpr bool contains(std::string_view word) const {
+        return word.size() >= 2 && words[perfect_hash(word)] == word;
+    }
 };
 
-const std::vector<std::string> keys = {
+template<size_t N>
+constexpr WordTable make_word_table(const std::string_view (&words)[N], Token::TokenKind kind) {
+    WordTable table{};
+    for (size_t i = 0; i < N; ++i) {
+        uint32_t slot = perfect_hash(words[i]);
+        if (!table.words[slot].empty()) table.perfect = false;
+        table.words[slot] = words[i];
+        table.kinds[slot] = kind;
+    }
+    return table;
+}
+
+constexpr std::string_view keyword_list[] = {
         "if", "else", "for", "while", "def", "let", "class", "new", "break", "continue", "return",
         "import", "public", "private"
 };
 
+constexpr std::string_view operator_list[] = {
+        "++", "--", "+=", "-=", "*=", "/=", "%=", ">>=", "<<=", ">>", "<<", "==", ">=", "<=", "!=", "**", "||", "&&", "|=", "&=", "^=", "->"
+};
+
+constexpr WordTable make_keyword_words() {
+    WordTable table = make_word_table(keyword_list, Token::TT_KEY);
+    for (std::string_view word : {std::string_view("true"), std::string_view("false")}) {
+        uint32_t slot = perfect_hash(word);
+        if (!table.words[slot].empty()) table.perfect = false;
+        table.words[slot] = word;
+        table.kinds[slot] = Token::TT_BOOL;
+    }
+    return table;
+}
+
+constexpr WordTable keyword_words = make_keyword_words();
+constexpr WordTable operator_words = make_word_table(operator_list, Token::TT_OP);
+
+static_assert(keyword_words.perfect, "keyword hash collides, pick another PERFECT_HASH_SEED");
+static_assert(operator_words.perfect, "operator hash collides, pick another PERFECT_HASH_SEED");
+
+// One-character operators are identified by their byte, longer ones by 256 plus
+// their slot in operator_words, so every operator id is below OPERATOR_IDS.
+constexpr int OPERATOR_IDS = 256 + (1 << PERFECT_HASH_BITS);
+
+constexpr uint16_t operator_id(std::string_view op) {
+    return (op.size() == 1)? (uint8_t)op[0] : (uint16_t)(256 + perfect_hash(op));
+}
+
 class Lexer {
 public:
-    Lexer(std::string expr) {
-        this->expr = expr;
+    Lexer(std::string expr) : source(std::move(expr)) {
         pos = -1;
-        lin = col = 1;
         advance();
-        make_tokens();
     }
 
-    int lin, col;
-    std::vector<Token> tokens;
-    std::vector<std::string> ops = {
-            "++", "--", "+=", "-=", "*=", "/=", "%=", ">>=", "<<=", ">>", "<<", "==", ">=", "<=", "!=", "**", "||", "&&", "|=", "&=", "->"
-    };
+    Lexer(std::shared_ptr<MappedFile> file) : source(std::move(file)) {
+        pos = -1;
+        advance();
+    }
+
+    Lexer(const Lexer&) = delete;
+
+    Source source;
+
+    // Tokens are lexed on demand. next() returns the next one, or nullptr at
+    // the end of input; it stays valid until the following call.
+    const Token* next() {
+        if (!scan(last)) return nullptr;
+        return &last;
+    }
+
 private:
     int pos;
     char current;
-    std::string expr;
+    std::string_view expr = source.text;
+    Token last;
 
-    Position make_pos() {
-        return Position(lin, col);
-    }
+    inline std::string_view slice(int begin, int end) { return expr.substr(begin, end - begin); }
 
     void advance(int len = 1) {
-        pos += len;
-        current = 0;
-        ++col;
-        if (pos < expr.size()) {
-            current = expr[pos];
-            if (current == '\n' || current == '\r') {
-                ++lin;
-                col = 1;
-            }
-        }
+        jump(pos + len);
     }
 
-    bool back_comp(std::string data) {
-        if (pos + data.size() > expr.size())
-            return false;
-        for (int i = 0; i < data.size(); ++i)
-            if (expr[pos + i] != data[i])
-                return false;
-        return true;
+    void jump(size_t to) {
+        pos = (int)to;
+        current = (to < expr.size())? expr[to] : 0;
     }
 
     Token make_string() {
-        auto begin = make_pos();
-        char eof = current;
+        int begin = pos;
+        jump(scan::find_either(expr, pos + 1, current, current));
+        int end = pos;
         advance();
-        std::string tmp;
-        while (current && current != eof) {
-            tmp += current;
-            advance();
-        }
-        advance();
-        auto end = make_pos();
-        return Token(tmp, Token::TT_STRING, begin, end);
+        return Token(slice(begin + 1, end), Token::TT_STRING, begin);
     }
 
     Token make_digit() {
-        auto begin = make_pos();
+        int begin = pos;
         Token::TokenKind kind = Token::TT_INTEGER;
-        std::string tmp;
-        while (current && (std::isdigit(current) || current == '.')) {
-            tmp += current;
+        while (current && (char_class(current) == CC_DIGIT || current == '.')) {
             if (current == '.') kind = Token::TT_FLOAT;
             advance();
         }
-        auto end_pos = make_pos();
-        return Token(tmp, kind, begin, end_pos);
+        return Token(slice(begin, pos), kind, begin);
     }
 
     Token make_id() {
-        auto begin = make_pos();
-        Token::TokenKind kind = Token::TT_ID;
-        std::string data;
-        while (current && (('a' <= current && current <= 'z') || ('A' <= current && current <= 'Z') || current == '_' || std::isdigit(current))) {
-            data += current;
-            advance();
-        }
-        if (std::count(keys.begin(), keys.end(), data) == 1) kind = Token::TT_KEY;
-        else if (data == "true" || data == "false") kind = Token::TT_BOOL;
-        auto end = make_pos();
-        return Token(data, kind, begin, end);
+        int begin = pos;
+        jump(scan::skip_id(expr, pos));
+        auto data = slice(begin, pos);
+        return Token(data, keyword_words.find(data, Token::TT_ID), begin);
     }
 
     void skip() {
-        while (current && (current != '\n' && current != '\r'))
-            advance();
+        jump(scan::find_either(expr, pos, '\n', '\r'));
+    }
+
+    // Longest operator starting at `pos`; every multi-char operator is 2 or 3 long.
+    int operator_length() {
+        size_t rest = expr.size() - (size_t)pos;
+        if (rest >= 3 && operator_words.contains(slice(pos, pos + 3))) return 3;
+        if (rest >= 2 && operator_words.contains(slice(pos, pos + 2))) return 2;
+        return 1;
     }
 
-    void make_tokens() {
+    bool scan(Token& token) {
         while (current) {
-            if (std::isdigit(current)) tokens.push_back(make_digit());
-            else if (('a' <= current && current <= 'z') || ('A' <= current && current <= 'Z') || current == '_')
-                tokens.push_back(make_id());
-            else if (current == '\'' || current == '"') tokens.push_back(make_string());
-            else if (current == '#') skip();
-            else if (!std::isspace(current)) {
-                std::string res;
-                bool isf = false;
-                for (auto i : ops)
-                    if (back_comp(i) && i.size() > res.size())
-                        res = i, isf = true;
-                if (isf) {
-                    tokens.emplace_back(res, Token::TT_OP, make_pos(), make_pos());
-                    advance(res.size());
-                    continue;
-                } else {
-                    tokens.emplace_back(std::string(1, current), Token::TT_OP, make_pos(), make_pos());
-                    advance();
+            switch (char_class(current)) {
+                case CC_DIGIT: token = make_digit(); return true;
+                case CC_IDENT: token = make_id(); return true;
+                case CC_QUOTE: token = make_string(); return true;
+                case CC_COMMENT: skip(); break;
+                case CC_SPACE: jump(scan::skip_space(expr, pos)); break;
+                default: {
+                    int len = operator_length();
+                    auto data = slice(pos, pos + len);
+                    token = Token(data, Token::TT_OP, pos, operator_id(data));
+                    advance(len);
+                    return true;
                 }
-            } else {
-                advance();
             }
         }
+        return false;
     }
 };
 
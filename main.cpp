@@ -1,28 +1,31 @@
 #include <iostream>
 #include "lexer.hpp"
 #include "parser.hpp"
+#include "flat_ast.hpp"
 #include "assembly.hpp"
-#include "execute.hpp"
 #include "interpreter.hpp"
+#include "execute.hpp"
 #include <fstream>
 
 #define TEST
 
 #ifdef RELEASE
 void start(int argc, char** argv) {
-    if (argc <= 1) {
-        printf("Usage: %s [FILE_NAME]", argv[0]);
+    std::string flag = (argc > 1)? argv[1] : "";
+    bool registers = flag == "--register-vm";
+    bool vm = registers || flag == "--vm";
+    if (argc <= 1 || (vm && argc <= 2)) {
+        printf("Usage: %s [--vm | --register-vm] [FILE_NAME]", argv[0]);
         return;
     }
-    std::string name = argv[1];
-    std::ifstream ifs(name);
-    std::string data, buffer;
-    while (std::getline(ifs, buffer))
-        data += buffer + '\n';
-    Lexer lexer(data);
-    Parser parser(lexer.tokens);
+    std::string name = argv[(vm)? 2 : 1];
     ModuleManager* mg = new ModuleManager;
-    Interpreter ip("<Program>", parser.ast, mg);
+    if (vm) {
+        VirtualMachine machine(parse_file(name), mg, registers);
+        machine.execute();
+        return;
+    }
+    Interpreter ip("<Program>", parse_file(name), mg);
 }
 #endif
 
@@ -34,22 +37,19 @@ void shell() {
         printf("shell > ");
         std::getline(std::cin, expr);
         Lexer lexer(expr);
-        Parser parser(lexer.tokens);
-        for (auto i: parser.ast)
-            decompiler(i, 0);
+        Parser parser(lexer);
+        FlatAST* ast = flatten(parser.ast);
+        for (auto i: ast->statements())
+            decompiler(*ast, i, 0);
+        delete ast;
     }
 }
 
 void run(std::string name) {
-    std::ifstream ifs(name);
-    std::string buffer, res;
-    while (std::getline(ifs, buffer))
-        res += buffer + '\n';
-    Lexer lexer(res);
-    Parser parser(lexer.tokens);
+    FlatAST* program = parse_file(name);
     printf("[%s] OUTPUT:\n", name.c_str());
     ModuleManager* mg = new ModuleManager;
-    Interpreter ip("<Program>", parser.ast, mg);
+    Interpreter ip("<Program>", program, mg);
 }
 
 void file() {
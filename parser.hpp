@@ -5,6 +5,8 @@
 #include "lexer.hpp"
 #include <vector>
 #include <unordered_map>
+#include <string_view>
+#include "arena.hpp"
 
 class AST {
 public:
@@ -13,16 +15,12 @@ public:
         A_FOR, A_CLASS, A_RETURN, A_BREAK, A_CONTINUE, A_BIN_OP, A_BIT_NOT,
         A_MEMBER_ACCESS, A_ID, A_ELEMENT_GET, A_CALL, A_NOT, A_ARRAY, A_SELF_INC,
         A_SELF_DEC, A_VAR_DEF, A_FUNC_DEFINE, A_SELF_OPERA, A_MEM_MALLOC, A_LAMBDA,
-        A_NULL, A_IMPORT
+        A_NULL, A_IMPORT, A_NEG
     } kind;
 
     AST(AKind kind) {
         this->kind = kind;
     }
-
-    ~AST() {
-        delete &kind;
-    }
 };
 
 class TypeNode {
@@ -51,12 +49,78 @@ public:
 
 class NormalKind : public TypeNode {
 public:
-    std::string type;
-    NormalKind(std::string type) : TypeNode(TN_NORMAL) {
+    std::string_view type;
+    NormalKind(std::string_view type) : TypeNode(TN_NORMAL) {
         this->type = type;
     }
 };
 
+enum Operator {
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD, OP_POW, OP_BIT_AND, OP_BIT_OR, OP_BIT_XOR, OP_LEFT_MOVE, OP_RIGHT_MOVE,
+    OP_EQ, OP_NOT_EQ, OP_LESS, OP_BIG, OP_LESS_OR_EQ, OP_BIG_OR_EQ, OP_COND_AND, OP_COND_OR,
+    OP_COUNT
+};
+
+const std::vector<std::string> operator_names = {
+        "+", "-", "*", "/", "%", "**", "&", "|", "^", "<<", ">>",
+        "==", "!=", "<", ">", "<=", ">=", "&&", "||"
+};
+
+// A parse error prints its message and exits, except on a thread that set
+// parse_errors_throw: ModuleManager's preload workers catch it as a ParseError
+// and leave the report to the main thread.
+inline thread_local bool parse_errors_throw = false;
+
+struct ParseError {
+    std::string message;
+};
+
+[[noreturn]] void parse_error(std::string message) {
+    if (parse_errors_throw) throw ParseError{message};
+    std::cout << message << std::endl;
+    exit(-1);
+}
+
+Operator to_operator(std::string_view op) {
+    for (int i = 0; i < OP_COUNT; ++i)
+        if (operator_names[i] == op)
+            return (Operator)i;
+    parse_error("Unknown operator '" + std::string(op) + "'");
+}
+
+// ======= Binary operator precedence
+// Left binding power of every binary operator, indexed by the operator_id the
+// lexer gives its token; 0 means the token does not continue an expression.
+// All levels are left associative.
+struct BinaryOperator {
+    uint8_t power;
+    Operator opcode;
+};
+
+struct BindingPowers {
+    BinaryOperator operators[OPERATOR_IDS];
+};
+
+constexpr struct { std::string_view op; uint8_t power; Operator opcode; } binary_operator_list[] = {
+        {"||", 1, OP_COND_OR},
+        {"&&", 2, OP_COND_AND},
+        {">", 3, OP_BIG}, {"<", 3, OP_LESS}, {">=", 3, OP_BIG_OR_EQ}, {"<=", 3, OP_LESS_OR_EQ},
+        {"==", 3, OP_EQ}, {"!=", 3, OP_NOT_EQ},
+        {"+", 4, OP_ADD}, {"-", 4, OP_SUB},
+        {"*", 5, OP_MUL}, {"/", 5, OP_DIV}, {"<<", 5, OP_LEFT_MOVE}, {">>", 5, OP_RIGHT_MOVE},
+        {"%", 5, OP_MOD}, {"^", 5, OP_BIT_XOR}, {"|", 5, OP_BIT_OR}, {"&", 5, OP_BIT_AND},
+        {"**", 6, OP_POW}
+};
+
+constexpr BindingPowers make_binding_powers() {
+    BindingPowers table{};
+    for (auto& entry : binary_operator_list)
+        table.operators[operator_id(entry.op)] = {entry.power, entry.opcode};
+    return table;
+}
+
+constexpr BindingPowers binding_powers = make_binding_powers();
+
 class TrueNode : public AST {
 public:
     TrueNode() : AST(AST::A_TRUE) { }
@@ -64,14 +128,10 @@ public:
 
 class ImportNode : public AST {
 public: 
-    std::string path;
-    ImportNode(std::string path) : AST(A_IMPORT) {
+    std::string_view path;
+    ImportNode(std::string_view path) : AST(A_IMPORT) {
         this->path = path;
     }
-
-    ~ImportNode() {
-        delete &path;
-    }
 };
 
 class FalseNode : public AST {
@@ -91,27 +151,19 @@ public:
         this->id = id;
         this->ipre = i;
     }
-
-    ~SelfIncNode() {
-        delete &ipre;
-        delete id;
-    }
 };
 
 class MemoryMallocNode : public AST {
 public:
-    std::string name;
+    std::string_view name;
     std::vector<AST*> args;
     bool is_call_c;
-    MemoryMallocNode(std::string name, std::vector<AST*> args, bool is_call_constructor) : AST(A_MEM_MALLOC) {
+    int class_slot = -1; // always -1 here; the FlatAST caches the class's root slot
+    MemoryMallocNode(std::string_view name, std::vector<AST*> args, bool is_call_constructor) : AST(A_MEM_MALLOC) {
         this->name = name;
         this->args = args;
         this->is_call_c = is_call_constructor;
     }
-    ~MemoryMallocNode() {
-        delete &name;
-        delete &args;
-    }
 };
 
 class SelfDecNode : public AST {
@@ -122,66 +174,46 @@ public:
         this->id = id;
         this->ipre = i;
     }
-
-    ~SelfDecNode() {
-        delete id;
-        delete &ipre;
-    }
 };
 
 class BinOpNode : public AST {
 public:
-    std::string op;
+    std::string_view op;
+    Operator opcode;
     AST *left, *right;
-    BinOpNode(std::string op, AST* left, AST* right) : AST(AST::A_BIN_OP) {
+    BinOpNode(std::string_view op, Operator opcode, AST* left, AST* right) : AST(AST::A_BIN_OP) {
         this->op = op;
+        this->opcode = opcode;
         this->right = right;
         this->left = left;
     }
-
-    ~BinOpNode() {
-        delete &op;
-        delete left;
-        delete right;
-    }
 };
 
 class MemberAccessNode : public AST {
 public:
     AST* parent;
-    std::string member;
-    MemberAccessNode(AST* left, std::string member) : AST(AST::A_MEMBER_ACCESS) {
+    std::string_view member;
+    MemberAccessNode(AST* left, std::string_view member) : AST(AST::A_MEMBER_ACCESS) {
         this->parent = left;
         this->member = member;
     }
-
-    ~MemberAccessNode() {
-        delete parent;
-        delete &member;
-    }
 };
 
 class StringNode : public AST {
 public:
-    std::string str;
-    StringNode(std::string str) : AST(AST::A_STRING) {
+    std::string_view str;
+    StringNode(std::string_view str) : AST(AST::A_STRING) {
         this->str = str;
     }
-
-    ~StringNode() {
-        delete &str;
-    }
 };
 
 class IntegerNode : public AST {
 public:
-    std::string number;
-    IntegerNode(std::string number) : AST(AST::A_INT) {
+    std::string_view number;
+    long long value;
+    IntegerNode(std::string_view number) : AST(AST::A_INT) {
         this->number = number;
-    }
-
-    ~IntegerNode() {
-        delete &number;
+        this->value = std::stoll(std::string(number));
     }
 };
 
@@ -191,21 +223,17 @@ public:
     BitNotNode(AST* expr) : AST(AST::A_BIT_NOT) {
         this->expr = expr;
     }
-
-    ~BitNotNode() {
-        delete &expr;
-    }
 };
 
 class IdNode : public AST {
 public:
-    std::string id;
-    IdNode(std::string id) : AST(AST::A_ID) {
-        this->id = id;
-    }
+    static const int GLOBAL = -1;
 
-    ~IdNode() {
-        delete &id;
+    std::string_view id;
+    int depth = GLOBAL; // Contexts to walk up, or GLOBAL for the root context
+    int slot = -1;      // slot in that Context, or -1 for GLOBAL names (the FlatAST caches their root slot)
+    IdNode(std::string_view id) : AST(AST::A_ID) {
+        this->id = id;
     }
 };
 
@@ -217,11 +245,6 @@ public:
         this->func_name = func_name;
         this->args = args;
     }
-
-    ~CallNode() {
-        delete func_name;
-        delete &args;
-    }
 };
 
 class ElementGetNode : public AST {
@@ -232,11 +255,6 @@ public:
         this->array_name = array_name;
         this->position = position;
     }
-
-    ~ElementGetNode() {
-        delete array_name;
-        delete position;
-    }
 };
 
 class NotNode : public AST {
@@ -245,22 +263,23 @@ public:
     NotNode(AST* expr) : AST(AST::A_NOT) {
         this->expr = expr;
     }
+};
 
-    ~NotNode() {
-        delete expr;
+class NegNode : public AST {
+public:
+    AST* expr;
+    NegNode(AST* expr) : AST(AST::A_NEG) {
+        this->expr = expr;
     }
 };
 
 class Block : public AST {
 public:
     std::vector<AST*> codes;
+    int scope_size = 0;
     Block(std::vector<AST*> codes) : AST(A_BLOCK) {
         this->codes = codes;
     }
-
-    ~Block() {
-        delete &codes;
-    }
 };
 
 class IfNode : public AST {
@@ -273,12 +292,6 @@ public:
         this->if_false = if_false;
         this->if_true = if_true;
     }
-
-    ~IfNode() {
-        delete condition;
-        delete if_false;
-        delete if_true;
-    }
 };
 
 class WhileNode : public AST {
@@ -289,11 +302,6 @@ public:
         this->condition = condition;
         this->body = body;
     }
-
-    ~WhileNode() {
-        delete condition;
-        delete body;
-    }
 };
 
 class LambdaNode : public AST {
@@ -304,67 +312,50 @@ public:
         this->args = args;
         this->body = body;
     }
-
-    ~LambdaNode() {
-        delete &args;
-        delete body;
-    }
 };
 
 
 class VarDefineNode : public AST {
 public:
-    std::string name;
+    std::string_view name;
     AST* init_value;
     TypeNode* vtype;
-    VarDefineNode(std::string name, TypeNode* vtype, AST* init_value = nullptr) : AST(A_VAR_DEF) {
+    int slot = -1; // -1 when defined in the root context
+    VarDefineNode(std::string_view name, TypeNode* vtype, AST* init_value = nullptr) : AST(A_VAR_DEF) {
         this->name = name;
         this->init_value = init_value;
         this->vtype = vtype;
     }
-
-    ~VarDefineNode() {
-        delete &name;
-        delete init_value;
-    }
 };
 
 class FunctionNode : public AST {
 public:
     Block* body;
-    std::string name;
+    std::string_view name;
     std::vector<AST*> args;
     FuncKind* kid;
-    FunctionNode(std::string name, std::vector<AST*> args, Block* body, FuncKind* fk) : AST(A_FUNC_DEFINE) {
+    FunctionNode(std::string_view name, std::vector<AST*> args, Block* body, FuncKind* fk) : AST(A_FUNC_DEFINE) {
         this->body = body;
         this->name = name;
         this->args = args;
         this->kid = fk;
     }
-
-    ~FunctionNode() {
-        delete body;
-        delete &name;
-        delete &args;
-    }
 };
 
 class SelfOperator : public AST {
 public:
-    std::string op;
+    std::string_view op;
+    bool is_assign;
+    Operator opcode; // "+=" -> OP_ADD, unused when is_assign
     AST* target;
     AST* value;
-    SelfOperator(std::string op, AST* target, AST* value) : AST(A_SELF_OPERA) {
+    SelfOperator(std::string_view op, AST* target, AST* value) : AST(A_SELF_OPERA) {
         this->op = op;
+        this->is_assign = (op == "=");
+        this->opcode = (is_assign)? OP_COUNT : to_operator(op.substr(0, op.size() - 1));
         this->target = target;
         this->value = value;
     }
-
-    ~SelfOperator() {
-        delete &op;
-        delete target;
-        delete value;
-    }
 };
 
 class ForNode : public AST {
@@ -379,13 +370,6 @@ public:
         this->change = change;
         this->body = body;
     }
-
-    ~ForNode() {
-        delete init;
-        delete is_continue;
-        delete change;
-        delete body;
-    }
 };
 
 class ContinueNode : public AST {
@@ -405,15 +389,11 @@ public:
     ReturnNode(AST* value) : AST(A_RETURN) {
         this->value = value;
     }
-
-    ~ReturnNode() {
-        delete value;
-    }
 };
 
 class ObjectNode : public AST {
 public:
-    std::string name;
+    std::string_view name;
 
     enum AccessState {
         PUBLIC, PRIVATE
@@ -421,7 +401,7 @@ public:
 
     std::unordered_map<std::string, AST*> members;
     std::unordered_map<std::string, AccessState> as;
-    ObjectNode(std::string name, std::unordered_map<std::string, AST*> members, std::unordered_map<std::string, AccessState> as) : AST(A_CLASS) {
+    ObjectNode(std::string_view name, std::unordered_map<std::string, AST*> members, std::unordered_map<std::string, AccessState> as) : AST(A_CLASS) {
         this->members = members;
         this->name = name;
         this->as = as;
@@ -430,11 +410,7 @@ public:
     AST* get_constructor() {
         if (members.find("constructor") == members.end())
             return nullptr;
-        return members[name];
-    }
-
-    ~ObjectNode() {
-        delete &name;
+        return members[std::string(name)];
     }
 };
 
@@ -449,21 +425,15 @@ public:
     ArrayNode(std::vector<AST*> elements) : AST(AST::A_ARRAY){
         this->elements = elements;
     }
-
-    ~ArrayNode() {
-        delete &elements;
-    }
 };
 
 class FloatNode : public AST {
 public:
-    std::string number;
-    FloatNode(std::string number) : AST(AST::A_FLO) {
+    std::string_view number;
+    double value;
+    FloatNode(std::string_view number) : AST(AST::A_FLO) {
         this->number = number;
-    }
-
-    ~FloatNode() {
-        delete &number;
+        this->value = std::stod(std::string(number));
     }
 };
 
@@ -473,13 +443,11 @@ typedef AST*(Parser::*CALLBACK_FUNCTION)();
 
 
 void make_error(std::string error_type, std::string error_info, Position error_pos) {
-    std::cout << error_type << ": " << error_info << " at lin " << error_pos.lin << ", col " << error_pos.col << std::endl;
-    exit(-1);
+    parse_error(error_type + ": " + error_info + " at lin " + std::to_string(error_pos.lin) + ", col " + std::to_string(error_pos.col));
 }
 
 void make_error(std::string error_type, std::string error_info) {
-    std::cout << error_type << ": " << error_info << " at EOF" << std::endl;
-    exit(-1);
+    parse_error(error_type + ": " + error_info + " at EOF");
 }
 
 class SymbolTable {
@@ -510,18 +478,21 @@ public:
 
 class Parser {
 public:
-    Parser(std::vector<Token> tokens) {
-        this->tokens = tokens;
-        pos = -1;
-        current = nullptr;
+    Parser(Lexer& lexer) {
+        this->lexer = &lexer;
+        this->arena = new Arena;
         advance();
         make_all();
         build_symbol_table();
     }
+    Parser(const Parser&) = delete;
+
+    ~Parser() { delete arena; }
+
     std::vector<AST*> ast;
 
     const std::vector<std::string> self_operator = {
-            "+=", "-=", "*=", "/=", "%=", ">>=", "<<=", "|=", "&=", "="
+            "+=", "-=", "*=", "/=", "%=", ">>=", "<<=", "|=", "&=", "^=", "="
     };
 
     void make_all() {
@@ -545,10 +516,10 @@ public:
                 auto tmp = make_expression();
                 if (std::count(self_operator.begin(), self_operator.end(), current->data) == 1 &&
                     (tmp->kind == AST::A_ID || tmp->kind == AST::A_MEMBER_ACCESS || tmp->kind == AST::A_ELEMENT_GET)) {
-                    std::string op = current->data;
+                    std::string_view op = current->data;
                     advance();
                     auto val = make_expression();
-                    tmp = new SelfOperator(op, tmp, val);
+                    tmp = node<SelfOperator>(text(op), tmp, val);
                 }
                 ast.push_back(tmp);
                 expect_data(";", get_pos());
@@ -557,44 +528,163 @@ public:
     }
 
 private:
-    std::vector<Token> tokens;
-    int pos;
-    Token* current;
+    Lexer* lexer;
+    const Token* current;
+    Arena* arena;
+
+    template<class T, class... Args>
+    T* node(Args&&... args) { return arena->make<T>(std::forward<Args>(args)...); }
+
+    std::string_view text(std::string_view str) { return arena->copy(str); }
+
+    // ======= Symbol table
+    // Resolves every IdNode to a (depth, slot) pair that mirrors the Contexts the
+    // interpreter creates at runtime: function frames hang off the root context,
+    // each executed block gets its own scope and a for-loop adds a scope for its
+    // init variable. Names that end up in the root context (builtins, top-level
+    // definitions, imported modules) stay GLOBAL and are bound by name on first use.
+    struct Scope {
+        std::string display_name;
+        bool is_function;
+        std::unordered_map<std::string_view, int> names;
+        int size;
+    };
 
-    std::unordered_map<std::string, SymbolTable> symbols;
+    std::vector<Scope> scopes;
 
     TypeNode* get_value_type(AST* a) {
 
     }
 
+    void enter_symbol_scope(std::string display_name, bool is_function = false) {
+        scopes.push_back({display_name, is_function, {}, 0});
+    }
+
+    int leave_symbol_scope() {
+        int size = scopes.back().size;
+        scopes.pop_back();
+        return size;
+    }
+
+    int declare(std::string_view name) {
+        auto& scope = scopes.back();
+        if (scope.names.find(name) != scope.names.end()) {
+            parse_error("Name '" + std::string(name) + "' double define in scope '" + scope.display_name + "'");
+        }
+        scope.names[name] = scope.size;
+        return scope.size++;
+    }
+
+    void build_id(IdNode* id) {
+        for (int i = (int)scopes.size() - 1; i > 0; --i) {
+            auto found = scopes[i].names.find(id->id);
+            if (found != scopes[i].names.end()) {
+                id->depth = (int)scopes.size() - 1 - i;
+                id->slot = found->second;
+                return;
+            }
+            if (scopes[i].is_function) break;
+        }
+        id->depth = IdNode::GLOBAL;
+        id->slot = -1;
+    }
+
     void build_var(VarDefineNode* vdn) {
+        build_node(vdn->init_value);
+        vdn->slot = (scopes.size() == 1)? -1 : declare(vdn->name);
+    }
 
+    void build_block(Block* block, std::string display_name) {
+        enter_symbol_scope(display_name);
+        for (auto i : block->codes) build_node(i);
+        block->scope_size = leave_symbol_scope();
     }
 
-    void build_function(FunctionNode *fn) {
+    // Function frames keep 'this' in slot 0 and the arguments right after it.
+    void build_callable(const std::vector<AST*>& args, Block* body, std::string display_name) {
+        enter_symbol_scope(display_name, true);
+        declare("this");
+        for (auto i : args) ((VarDefineNode*)i)->slot = declare(((VarDefineNode*)i)->name);
+        for (auto i : body->codes) build_node(i);
+        body->scope_size = leave_symbol_scope();
+    }
 
+    void build_function(FunctionNode *fn) {
+        build_callable(fn->args, fn->body, std::string(fn->name));
     }
 
     void build_object(ObjectNode *oj) {
+        for (auto i : oj->members) {
+            if (i.second->kind == AST::A_FUNC_DEFINE) build_function((FunctionNode*)i.second);
+            else build_node(((VarDefineNode*)i.second)->init_value);
+        }
+    }
 
+    void build_node(AST* a) {
+        if (!a) return;
+        switch (a->kind) {
+            case AST::A_ID: build_id((IdNode*)a); break;
+            case AST::A_VAR_DEF: build_var((VarDefineNode*)a); break;
+            case AST::A_FUNC_DEFINE: build_function((FunctionNode*)a); break;
+            case AST::A_CLASS: build_object((ObjectNode*)a); break;
+            case AST::A_LAMBDA: build_callable(((LambdaNode*)a)->args, ((LambdaNode*)a)->body, "<UserDefineSubProgram>"); break;
+            case AST::A_IF: {
+                auto n = (IfNode*) a;
+                build_node(n->condition);
+                build_block(n->if_true, "<If>");
+                if (n->if_false) build_block(n->if_false, "<If>");
+                break;
+            }
+            case AST::A_FOR: {
+                auto n = (ForNode*) a;
+                enter_symbol_scope("<For-Loop-Condition>");
+                build_node(n->init);
+                build_node(n->is_continue);
+                build_node(n->change);
+                build_block(n->body, "<For-Loop-Frame>");
+                leave_symbol_scope();
+                break;
+            }
+            case AST::A_WHILE: {
+                build_node(((WhileNode*)a)->condition);
+                build_block(((WhileNode*)a)->body, "<While-Loop-Frame>");
+                break;
+            }
+            case AST::A_BLOCK: for (auto i : ((Block*)a)->codes) build_node(i); break;
+            case AST::A_BIN_OP: build_node(((BinOpNode*)a)->left), build_node(((BinOpNode*)a)->right); break;
+            case AST::A_NOT: build_node(((NotNode*)a)->expr); break;
+            case AST::A_NEG: build_node(((NegNode*)a)->expr); break;
+            case AST::A_BIT_NOT: build_node(((BitNotNode*)a)->expr); break;
+            case AST::A_MEMBER_ACCESS: build_node(((MemberAccessNode*)a)->parent); break;
+            case AST::A_ELEMENT_GET: build_node(((ElementGetNode*)a)->array_name), build_node(((ElementGetNode*)a)->position); break;
+            case AST::A_CALL: {
+                build_node(((CallNode*)a)->func_name);
+                for (auto i : ((CallNode*)a)->args) build_node(i);
+                break;
+            }
+            case AST::A_SELF_INC: build_node(((SelfIncNode*)a)->id); break;
+            case AST::A_SELF_DEC: build_node(((SelfDecNode*)a)->id); break;
+            case AST::A_SELF_OPERA: build_node(((SelfOperator*)a)->target), build_node(((SelfOperator*)a)->value); break;
+            case AST::A_MEM_MALLOC: for (auto i : ((MemoryMallocNode*)a)->args) build_node(i); break;
+            case AST::A_ARRAY: for (auto i : ((ArrayNode*)a)->elements) build_node(i); break;
+            case AST::A_RETURN: build_node(((ReturnNode*)a)->value); break;
+            default: break;
+        }
     }
 
     void build_symbol_table() {
-        for (auto i : ast) {
-            int t = i->kind;
-            if (t == AST::A_VAR_DEF) build_var((VarDefineNode*)i);
-            if (t == AST::A_FUNC_DEFINE) build_function((FunctionNode*)i);
-            if (t == AST::A_CLASS) build_object((ObjectNode*)i);
-        }
+        enter_symbol_scope("<Program>");
+        for (auto i : ast) build_node(i);
+        leave_symbol_scope();
     }
 
     bool match(Token::TokenKind kind) { return current != nullptr && current->kind == kind; }
 
     bool match(std::string data) { return current != nullptr && current->data == data; }
 
-    std::string expect_get(Token::TokenKind kind) {
+    std::string_view expect_get(Token::TokenKind kind) {
         if (!match(kind))
-            make_error("SyntaxError", "want '" + std::to_string(kind) + "' get '" + current->data + "'");
+            make_error("SyntaxError", "want '" + std::to_string(kind) + "' get '" + std::string(current->data) + "'");
         auto tmp = current->data;
         advance();
         return tmp;
@@ -602,47 +692,47 @@ private:
 
     void expect_data(std::string name, Position _pos) {
         if (!current || !match(name))
-            make_error("SyntaxError", "want '" + name + "', meet '" + ((current)? current->data : "None"), _pos);
+            make_error("SyntaxError", "want '" + name + "', meet '" + ((current)? std::string(current->data) : "None"), _pos);
         advance();
     }
 
-    Position get_pos() { if (!current) { make_error("SyntaxError", "meet eof"); } return current->start_pos; }
+    Position get_pos() { if (!current) { make_error("SyntaxError", "meet eof"); } return lexer->source.position(current->offset); }
 
     ImportNode* make_import() {
         expect_data("import", get_pos());
         auto path = expect_get(Token::TT_STRING);
         expect_data(";", get_pos());
-        return new ImportNode(path);
+        return node<ImportNode>(text(path));
     }
 
     LambdaNode* make_lambda() {
         expect_data("$", get_pos());
         auto args = make_area("(", ")", ",", &Parser::make_var_define);
         auto body = make_block();
-        return new LambdaNode(args, body);
+        return node<LambdaNode>(args, body);
     }
 
     ContinueNode* make_continue() {
-        ++pos;
+        expect_data("continue", get_pos());
         expect_data(";", get_pos());
-        return new ContinueNode();
+        return node<ContinueNode>();
     }
 
     ReturnNode* make_return() {
         expect_data("return", get_pos());
         if (match(";")) {
             advance();
-            return new ReturnNode(nullptr);
+            return node<ReturnNode>(nullptr);
         }
         auto val = make_expression();
         expect_data(";", get_pos());
-        return new ReturnNode(val);
+        return node<ReturnNode>(val);
     }
 
     BreakNode* make_break() {
-        ++pos;
+        expect_data("break", get_pos());
         expect_data(";", get_pos());
-        return new BreakNode();
+        return node<BreakNode>();
     }
 
     IfNode* make_if() {
@@ -656,7 +746,7 @@ private:
             advance();
             el = make_block();
         }
-        return new IfNode(cond, body, el);
+        return node<IfNode>(cond, body, el);
     }
 
     TypeNode* make_type() {
@@ -664,14 +754,14 @@ private:
         // [TypeName]
         // func(Type1, Type2, ..., TypeN) ReturnType
         if (match(Token::TT_ID) && !match("func")) {
-            std::string tn = current->data;
+            std::string_view tn = current->data;
             advance();
-            return new NormalKind(tn);
+            return node<NormalKind>(text(tn));
         } else if (match("[")) {
             advance();
             auto t = make_type();
             expect_data("]", get_pos());
-            return new ArrayKind(t);
+            return node<ArrayKind>(t);
         } else if (match("func")) {
             advance();
             expect_data("(", get_pos());
@@ -684,16 +774,15 @@ private:
             expect_data(")", get_pos());
             expect_data("->", get_pos());
             TypeNode* ret_type = make_type();
-            return new FuncKind(type, ret_type);
+            return node<FuncKind>(type, ret_type);
         } else {
-            std::cout << "Unknown type '" << ((current)? current->data : "None") << std::endl;
-            exit(-1);
+            parse_error("Unknown type '" + std::string((current)? current->data : "None"));
         }
     }
 
     FunctionNode* make_function_define() {
         if (match("def")) advance();
-        std::string name = expect_get(Token::TT_ID);
+        std::string_view name = expect_get(Token::TT_ID);
         std::vector<AST*> vals = make_area("(", ")", ",", &Parser::make_var_define);
         int w = 0;
         TypeNode* type = nullptr;
@@ -704,29 +793,28 @@ private:
         std::vector<TypeNode*> types;
         for (auto i : vals) types.push_back(((VarDefineNode*)i)->vtype);
         auto body = make_block();
-        return new FunctionNode(name, vals, body, new FuncKind(types, type));
+        return node<FunctionNode>(text(name), vals, body, node<FuncKind>(types, type));
     }
 
     AST* make_var_define() {
-        std::string name;
         AST* init_value = nullptr;
-        name = expect_get(Token::TT_ID);
+        std::string_view name = expect_get(Token::TT_ID);
         expect_data(":", get_pos());
         TypeNode* tn = make_type();
         if (match("=")) {
             advance();
             init_value = make_expression();
         }
-        return new VarDefineNode(name, tn, init_value);
+        return node<VarDefineNode>(text(name), tn, init_value);
     }
 
     MemoryMallocNode* make_malloc() {
         expect_data("new", get_pos());
-        std::string name = expect_get(Token::TT_ID);
+        std::string_view name = expect_get(Token::TT_ID);
         std::vector<AST*> arg;
         bool is_call_constructor = false;
         if (match("(")) is_call_constructor = true, arg = make_area("(", ")", ",", &Parser::make_expression);
-        return new MemoryMallocNode(name, arg, is_call_constructor);
+        return node<MemoryMallocNode>(text(name), arg, is_call_constructor);
     }
 
     WhileNode* make_while() {
@@ -735,7 +823,7 @@ private:
         auto condition = make_expression();
         expect_data(")", get_pos());
         auto block = make_block();
-        return new WhileNode(condition, block);
+        return node<WhileNode>(condition, block);
     }
 
     std::vector<AST*> make_var_define_group() {
@@ -744,7 +832,7 @@ private:
 
     NullNode* make_null () {
         expect_data("null", get_pos());
-        return new NullNode();
+        return node<NullNode>();
     }
 
     ForNode* make_for() {
@@ -759,38 +847,41 @@ private:
         change = make_expression();
         expect_data(")", get_pos());
         body = make_block();
-        return new ForNode(init, is_continue, change, body);
+        return node<ForNode>(init, is_continue, change, body);
     }
 
     ObjectNode* make_class() {
         expect_data("class", get_pos());
         std::unordered_map<std::string, AST*> members;
         std::unordered_map<std::string, ObjectNode::AccessState> as;
-        std::string name = expect_get(Token::TT_ID);
+        std::string_view name = expect_get(Token::TT_ID);
         expect_data("{", get_pos());
         ObjectNode::AccessState _as = ObjectNode::PRIVATE;
         while (current && !match("}")) {
             if (match("public")) advance(), _as = ObjectNode::PUBLIC;
             else if (match("private")) advance(),_as = ObjectNode::PRIVATE;
             if (match("def") || match("constructor")) {
-                std::string name = current->data;
+                std::string_view name = current->data;
                 if (name == "constructor") _as = ObjectNode::PUBLIC;
                 auto tmp = make_function_define();
-                members[tmp->name] = tmp;
-                as[name] = _as;
+                members[std::string(tmp->name)] = tmp;
+                as[std::string(name)] = _as;
                 _as = ObjectNode::PRIVATE;
             } else if (match("let")) {
                 auto vars = make_var_define_group();
-                for (auto i : vars) members[((VarDefineNode*)i)->name] = i, as[((VarDefineNode*)i)->name] = _as;
+                for (auto i : vars) {
+                    std::string var_name(((VarDefineNode*)i)->name);
+                    members[var_name] = i, as[var_name] = _as;
+                }
             } else {
                 auto v = (VarDefineNode*)make_var_define();
-                members[v->name] = v;
-                as[v->name] = _as;
+                members[std::string(v->name)] = v;
+                as[std::string(v->name)] = _as;
                 expect_data(";", get_pos());
             }
         }
         expect_data("}", get_pos());
-        return new ObjectNode(name, members, as);
+        return node<ObjectNode>(text(name), members, as);
     }
 
     Block* make_block() {
@@ -812,15 +903,15 @@ private:
                 auto tmp = make_expression();
                 if (std::count(self_operator.begin(), self_operator.end(), current->data) == 1 &&
                     (tmp->kind == AST::A_ID || tmp->kind == AST::A_MEMBER_ACCESS || tmp->kind == AST::A_ELEMENT_GET)) {
-                    std::string op = current->data;
+                    std::string_view op = current->data;
                     advance();
                     auto val = make_expression();
-                    tmp = new SelfOperator(op, tmp, val);
+                    tmp = node<SelfOperator>(text(op), tmp, val);
                 }
                 expect_data(";", get_pos());
                 codes.push_back(tmp);
             }
-            return new Block(codes);
+            return node<Block>(codes);
         }
         expect_data("{", get_pos());
         std::vector<AST*> codes;
@@ -841,38 +932,20 @@ private:
                 auto tmp = make_expression();
                 if (std::count(self_operator.begin(), self_operator.end(), current->data) == 1 &&
                     (tmp->kind == AST::A_ID || tmp->kind == AST::A_MEMBER_ACCESS || tmp->kind == AST::A_ELEMENT_GET)) {
-                    std::string op = current->data;
+                    std::string_view op = current->data;
                     advance();
                     auto val = make_expression();
-                    tmp = new SelfOperator(op, tmp, val);
+                    tmp = node<SelfOperator>(text(op), tmp, val);
                 }
                 expect_data(";", get_pos());
                 codes.push_back(tmp);
             }
         }
         expect_data("}", get_pos());
-        return new Block(codes);
+        return node<Block>(codes);
     }
 
-    void advance() {
-        ++pos;
-        current = nullptr;
-        if (pos < tokens.size())
-            current = &tokens[pos];
-    }
-
-    AST* make_bin_op_node(CALLBACK_FUNCTION left_process, std::vector<std::string> opers, CALLBACK_FUNCTION right_process = nullptr) {
-        if (right_process == nullptr)
-            right_process = left_process;
-        AST* left = (this->*left_process)();
-        while (current && std::count(opers.begin(), opers.end(), current->data) > 0) {
-            std::string op = current->data;
-            advance();
-            AST* right = (this->*right_process)();
-            left = new BinOpNode(op, left, right);
-        }
-        return left;
-    }
+    void advance() { current = lexer->next(); }
 
     std::vector<AST*> make_area(std::string begin, std::string end, std::string split, CALLBACK_FUNCTION proc, int cnt = -1) {
         std::vector<AST*> res;
@@ -895,10 +968,10 @@ private:
         while (current && (match("(") || match("[") || match("."))) {
             if (match("(")) {
                 auto args = make_area("(", ")", ",", &Parser::make_expression);
-                name = new CallNode(name, args);
+                name = node<CallNode>(name, args);
             } else if (match("[")) {
                 advance();
-                name = new ElementGetNode(name, make_expression());
+                name = node<ElementGetNode>(name, make_expression());
                 expect_data("]", get_pos());
             } else if (match(".")) {
                 name = _make_member_access(name);
@@ -914,14 +987,14 @@ private:
     AST* _make_element_get_node(AST* name) {
         while (current && (match("["))) {
             advance();
-            name = new ElementGetNode(name, make_expression());
+            name = node<ElementGetNode>(name, make_expression());
             expect_data("]", get_pos());
         }
         return name;
     }
 
     AST* make_member_access() {
-        AST* left = new IdNode(current->data);
+        AST* left = node<IdNode>(text(current->data));
         advance();
         return _make_member_access(left);
     }
@@ -929,43 +1002,58 @@ private:
     AST* _make_member_access(AST* left) {
         while (current && match(".")) {
             advance();
-            left = new MemberAccessNode(left, current->data);
+            left = node<MemberAccessNode>(left, text(current->data));
             advance();
         }
         return left;
     }
 
     AST* make_expression() {
-        return make_bin_op_node(&Parser::make_expression5, {"||"});
+        return make_binary(0);
     }
 
-    AST* make_expression5() {
-        return make_bin_op_node(&Parser::make_expression4, {"&&"});
-    }
-
-    AST* make_expression4() {
-        return make_bin_op_node(&Parser::make_expression3, {">", "<", ">=", "<=", "==", "!="});
+    // Parses operands joined by operators that bind tighter than `min_power`.
+    AST* make_binary(int min_power) {
+        AST* left = make_unary();
+        while (current && current->kind == Token::TT_OP) {
+            const BinaryOperator& op = binding_powers.operators[current->id];
+            if (op.power <= min_power) break;
+            std::string_view data = current->data;
+            advance();
+            left = node<BinOpNode>(text(data), op.opcode, left, make_binary(op.power));
+        }
+        return left;
     }
 
-    AST* make_expression3() {
-        return make_bin_op_node(&Parser::make_expression2, {"+", "-"});
+    std::string_view negated(std::string_view number) {
+        return (number[0] == '-')? number.substr(1) : text("-" + std::string(number));
     }
 
-    AST* make_expression2() {
-        return make_bin_op_node(&Parser::make_expression1, {"*", "/", "<<", ">>", "%", "^", "|", "&"});
+    // Prefix operators bind tighter than any binary operator: -a ** b is (-a) ** b.
+    AST* make_unary() {
+        if (!current || current->kind != Token::TT_OP) return make_value();
+        switch (current->id) {
+            case '-': {
+                advance();
+                AST* operand = make_unary();
+                if (operand->kind == AST::A_INT) return node<IntegerNode>(negated(((IntegerNode*)operand)->number));
+                if (operand->kind == AST::A_FLO) return node<FloatNode>(negated(((FloatNode*)operand)->number));
+                return node<NegNode>(operand);
+            }
+            case '+': advance(); return make_unary();
+            case '!': advance(); return node<NotNode>(make_unary());
+            case '~': advance(); return node<BitNotNode>(make_unary());
+            default: return make_value();
+        }
     }
 
     AST* make_array() {
-        return new ArrayNode(make_area("[", "]", ",", &Parser::make_expression));
-    }
-
-    AST* make_expression1() {
-        return make_bin_op_node(&Parser::make_value, {"**"});
+        return node<ArrayNode>(make_area("[", "]", ",", &Parser::make_expression));
     }
 
     AST* make_value() {
         if (match(Token::TT_INTEGER)) {
-            auto tmp = new IntegerNode(current->data);
+            auto tmp = node<IntegerNode>(text(current->data));
             advance();
             return tmp;
         } else if (match("$")) {
@@ -974,14 +1062,14 @@ private:
             return make_null();
         } else if (match("++")) {
             advance();
-            return new SelfIncNode(make_value(), pre);
+            return node<SelfIncNode>(make_value(), pre);
         } else if (match("--")) {
             advance();
-            return new SelfDecNode(make_value(), pre);
+            return node<SelfDecNode>(make_value(), pre);
         } else if (match("new")) {
             return make_malloc();
         } else if (match(Token::TT_FLOAT)) {
-            auto tmp = new FloatNode(current->data);
+            auto tmp = node<FloatNode>(text(current->data));
             advance();
             return tmp;
         } else if (match("[")) {
@@ -996,34 +1084,25 @@ private:
             }
             return tmp;
         } else if (match(Token::TT_STRING)) {
-            auto t = new StringNode(current->data);
+            auto t = node<StringNode>(text(current->data));
             advance();
             return t;
-        } else if (match("~")) {
-            advance();
-            return new BitNotNode(make_value());
-        } else if (match("!")) {
-            advance();
-            return new NotNode(make_value());
-        } else if (match("-")) {
-            advance();
-            return new BinOpNode("*", new FloatNode("-1.0"), make_value());
         } else if (match("true")) {
             advance();
-            return new TrueNode();
+            return node<TrueNode>();
         } else if (match("false")) {
             advance();
-            return new FalseNode();
+            return node<FalseNode>();
         } else if (match(Token::TT_ID)) {
             auto tmp = make_call_node();
             while (match("++") || match("--")) {
                 if (match("++")) {
                     advance();
-                    tmp = new SelfIncNode(tmp, npre);
+                    tmp = node<SelfIncNode>(tmp, npre);
                 }
                 if (match("--")) {
                     advance();
-                    tmp = new SelfDecNode(tmp, npre);
+                    tmp = node<SelfDecNode>(tmp, npre);
                 }
             }
             return tmp;
@@ -1040,232 +1119,4 @@ private:
     }
 };
 
-std::string print_indent(int indent) {
-    std::string res;
-    while (indent--) res += "    ";
-    return res;
-}
-
-void decompiler(AST* a, int indent = 0, std::string fo = "") {
-    switch (a->kind) {
-        case AST::A_ID: {
-            std::cout << print_indent(indent) << fo << "Id<" << ((IdNode*)a)->id << ">\n";
-            break;
-        }
-        case AST::A_IF: {
-            auto n = (IfNode*) a;
-            std::cout << print_indent(indent) << fo << "IfNode {\n";
-            decompiler(n->condition, indent + 1, "Condition: ");
-            decompiler(n->if_true, indent + 1, "IfConditionIsTrue: ");
-            if (n->if_false) decompiler(n->if_false, indent + 1, "IfNotTrue: ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_BLOCK: {
-            auto al = (Block*) a;
-            std::cout << print_indent(indent) << fo << "Block {\n";
-            for (int i = 0; i < al->codes.size(); ++i)
-                decompiler(al->codes[i], indent + 1, std::to_string(i) + ": ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_STRING: {
-            std::cout << print_indent(indent) << fo << "String('" << ((StringNode*)a)->str << "')\n";
-            break;
-        }
-        case AST::A_INT: {
-            std::cout << print_indent(indent) << fo << "Int('" << ((IntegerNode*)a)->number << "')\n";
-            break;
-        }
-        case AST::A_FLO: {
-            std::cout << print_indent(indent) << fo << "Float('" << ((FloatNode*)a)->number << "')\n";
-            break;
-        }
-        case AST::A_ARRAY: {
-            auto node = (ArrayNode*) a;
-            std::cout << print_indent(indent) << fo << "Array: [\n";
-            for (int i = 0; i < node->elements.size(); ++i)
-                decompiler(node->elements[i], indent + 1, "E[" + std::to_string(i) + "] = ");
-            std::cout << print_indent(indent) << "]\n";
-            break;
-        }
-        case AST::A_TRUE: {
-            std::cout << print_indent(indent) << fo << "Bool<true>\n";
-            break;
-        }
-        case AST::A_FALSE: {
-            std::cout << print_indent(indent) << fo << "Bool<false>\n";
-            break;
-        }
-        case AST::A_WHILE: {
-            std::cout << print_indent(indent) << fo << "WhileNode {\n";
-            auto w = (WhileNode*) a;
-            decompiler(w->condition, indent + 1, "Condition: ");
-            decompiler(w->body, indent + 1, "Body: ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_FOR: {
-            std::cout << print_indent(indent) << fo << "ForLoopNode {\n";
-            auto n = (ForNode*)a;
-            decompiler(n->init, indent + 1, "ForLoopInit: ");
-            decompiler(n->is_continue, indent + 1, "LoopCondition: ");
-            decompiler(n->change, indent + 1, "ForLoopChange: ");
-            decompiler(n->body, indent + 1, "ForLoopBody: ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_CLASS: {
-            auto node = (ObjectNode*) a;
-            std::cout << print_indent(indent) << fo << "Class {\n";
-            std::cout << print_indent(indent + 1) << "Name: " << node->name << std::endl;
-            if (!node->members.empty()) {
-                std::cout << print_indent(indent + 1) << "Members [\n";
-                for (auto i : node->members)
-                    decompiler(i.second, indent + 2, i.first + ": ");
-                std::cout << print_indent(indent + 1) << "]\n";
-            }
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_RETURN: {
-            std::cout << print_indent(indent) << fo << "ReturnSignal(\n";
-            decompiler(((ReturnNode*)a)->value, indent + 1, "ReturnValue: ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_BREAK: {
-            std::cout << print_indent(indent) << fo << "<BreakSignal>\n";
-            break;
-        }
-        case AST::A_CONTINUE: {
-            std::cout << print_indent(indent) << fo << "<ContinueSignal>\n";
-            break;
-        }
-        case AST::A_NOT: {
-            std::cout << print_indent(indent) << fo << "Not(\n";
-            decompiler(((NotNode*)a)->expr, indent + 1);
-            std::cout << print_indent(indent) << ")\n";
-            break;
-        }
-        case AST::A_BIN_OP: {
-            std::cout << print_indent(indent) << fo << "BinOpNode: <'" << ((BinOpNode*)a)->op << "'>{\n";
-            decompiler(((BinOpNode*)a)->left, indent + 1, "Left: ");
-            decompiler(((BinOpNode*)a)->right, indent + 1, "Right: ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_BIT_NOT: {
-            std::cout << print_indent(indent) << fo << "BitNode: ";
-            decompiler(((BitNotNode*)a)->expr, indent + 1);
-            break;
-        }
-        case AST::A_MEMBER_ACCESS: {
-            std::cout << print_indent(indent) << fo << "MemberAccessNode {\n";
-            decompiler(((MemberAccessNode*)a)->parent, indent + 1, "ParentClass: ");
-            std::cout << print_indent(indent + 1) << "Member: " << ((MemberAccessNode*)a)->member << std::endl;
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_ELEMENT_GET: {
-            auto node = (ElementGetNode*)a;
-            std::cout << print_indent(indent) << fo << "ElementGetNode {\n";
-            decompiler(node->array_name, indent + 1, "ArrayAddress: ");
-            decompiler(node->position, indent + 1, "Position: ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_CALL: {
-            std::cout << print_indent(indent) << fo << "CallNode { \n";
-            decompiler(((CallNode*)a)->func_name, indent + 1, "FuncAddress: ");
-            std::cout << print_indent(indent + 1) << "Args: [" ;
-            std::string ind;
-            if (!((CallNode*)a)->args.empty()) {
-                printf("\n");
-                ind = print_indent(indent + 1);
-                for (int i = 0; i < ((CallNode *) a)->args.size(); ++i)
-                    decompiler(((CallNode *) a)->args[i], indent + 2, "Args[" + std::to_string(i) + "]: ");
-            }
-            std::cout << ind << "]\n";
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_SELF_INC: {
-            auto node = (SelfIncNode*) a;
-            std::cout << print_indent(indent) << fo << "SelfInc {\n";
-            std::cout << print_indent(indent + 1) << "PRE: " << node->ipre << std::endl;
-            decompiler(node->id, indent + 1, "Address: ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_SELF_DEC: {
-            auto node = (SelfDecNode*) a;
-            std::cout << print_indent(indent) << fo << "SelfDec {\n";
-            std::cout << print_indent(indent + 1) << "PRE: " << node->ipre << std::endl;
-            decompiler(node->id, indent + 1, "Address: ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_VAR_DEF: {
-            auto v = (VarDefineNode*) a;
-            std::cout << print_indent(indent) << fo << "VarDefine {\n";
-            std::cout << print_indent(indent + 1) << "VarName: " << v->name << "\n";
-            if (v->init_value) decompiler(v->init_value, indent + 1, "InitValue: ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_FUNC_DEFINE: {
-            auto fn = (FunctionNode*) a;
-            auto fn_arg = fn->args;
-            std::cout << print_indent(indent) << fo << "FunctionDefine<'" << fn->name << "'> {\n";
-            std::cout << print_indent(indent + 1) << "FunctionArgs: ";
-            if (fn_arg.empty()) { std::cout << "[ ]\n"; }
-            else {
-                std::cout << "[\n";
-                for (int i = 0; i < fn_arg.size(); ++i)
-                    decompiler(fn_arg[i], indent + 2, std::to_string(i) + ": ");
-                std::cout << print_indent(indent + 1) << "]\n";
-            }
-            decompiler(fn->body, indent + 1, "FuncBody: ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_SELF_OPERA: {
-            auto sa = (SelfOperator*) a;
-            std::cout << print_indent(indent) << fo << "SelfOperator<'" + sa->op << "'> {\n";
-            decompiler(sa->target, indent + 1, "Target: ");
-            decompiler(sa->value, indent + 1, "Value: ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_LAMBDA: {
-            std::cout << print_indent(indent) << fo << "Lambda {\n";
-            auto ln = (LambdaNode*) a;
-            std::cout << print_indent(indent + 1) << "Args: (\n";
-            for (int i = 0; i < ln->args.size(); ++i)
-                decompiler(ln->args[i], indent + 2, std::to_string(i) + ": ");
-            std::cout << print_indent(indent + 1) << ")\n";
-            decompiler(ln->body, indent + 1, "Body: ");
-            std::cout << print_indent(indent) << "}\n";
-            break;
-        }
-        case AST::A_MEM_MALLOC: {
-            std::cout << print_indent(indent) << fo << "MemoryMalloc (\n";
-            auto n = (MemoryMallocNode*) a;
-            for (int i = 0; i < n->args.size(); ++i)
-                decompiler(n->args[i], indent + 1, std::to_string(i) + ": ");
-            std::cout << print_indent(indent) << ")\n";
-            break;
-        }
-        case AST::A_NULL: {
-            std::cout << print_indent(indent) << fo << "Null\n";
-            break;
-        }
-        case AST::A_IMPORT: {
-            std::cout << print_indent(indent) << "Import(" << ((ImportNode*)a)->path << ")\n";
-            break;
-        }
-    }
-}
-
 #endif
\ No newline at end of file
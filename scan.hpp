@@ -0,0 +1,149 @@
+#ifndef OPL_SCAN_HPP
+#define OPL_SCAN_HPP
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// ======= Vectorized byte scanning
+// The lexer spends most of its time walking runs of bytes: identifiers,
+// whitespace, comment bodies, string bodies and the newlines of the whole
+// source. Each walk is a search for the first byte that ends the run, done here
+// 32 (AVX2) or 16 (SSE2) bytes at a time by comparing a whole chunk and taking
+// the lowest set bit of the match mask. The tail, and targets without SIMD, use
+// the scalar loop.
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OPL_SIMD_WIDTH 32
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OPL_SIMD_WIDTH 16
+#endif
+
+#if defined(OPL_SIMD_WIDTH) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace scan {
+
+#ifdef OPL_SIMD_WIDTH
+inline int lowest_bit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+#if OPL_SIMD_WIDTH == 32
+struct Bytes {
+    __m256i v;
+    static Bytes load(const char* p) { return {_mm256_loadu_si256((const __m256i*)p)}; }
+    static Bytes splat(char c) { return {_mm256_set1_epi8(c)}; }
+    Bytes operator==(Bytes o) const { return {_mm256_cmpeq_epi8(v, o.v)}; }
+    Bytes operator|(Bytes o) const { return {_mm256_or_si256(v, o.v)}; }
+    Bytes operator-(Bytes o) const { return {_mm256_sub_epi8(v, o.v)}; }
+    Bytes operator~() const { return {_mm256_xor_si256(v, _mm256_set1_epi8(-1))}; }
+    // Unsigned v <= o, lane by lane.
+    Bytes at_most(Bytes o) const { return {_mm256_cmpeq_epi8(_mm256_min_epu8(v, o.v), v)}; }
+    uint32_t mask() const { return (uint32_t)_mm256_movemask_epi8(v); }
+};
+#else
+struct Bytes {
+    __m128i v;
+    static Bytes load(const char* p) { return {_mm_loadu_si128((const __m128i*)p)}; }
+    static Bytes splat(char c) { return {_mm_set1_epi8(c)}; }
+    Bytes operator==(Bytes o) const { return {_mm_cmpeq_epi8(v, o.v)}; }
+    Bytes operator|(Bytes o) const { return {_mm_or_si128(v, o.v)}; }
+    Bytes operator-(Bytes o) const { return {_mm_sub_epi8(v, o.v)}; }
+    Bytes operator~() const { return {_mm_xor_si128(v, _mm_set1_epi8(-1))}; }
+    Bytes at_most(Bytes o) const { return {_mm_cmpeq_epi8(_mm_min_epu8(v, o.v), v)}; }
+    uint32_t mask() const { return (uint32_t)_mm_movemask_epi8(v); }
+};
+#endif
+
+// c - lo <= hi - lo, i.e. lo <= c <= hi, for every lane.
+inline Bytes in_range(Bytes c, char lo, char hi) {
+    return (c - Bytes::splat(lo)).at_most(Bytes::splat((char)(hi - lo)));
+}
+#endif
+
+// Index of the first byte at or after `i` for which `stop` holds, or
+// text.size(). `stop_chunk` is the same predicate over a whole chunk. Runs that
+// are usually short (a space, a short name) are probed bytewise for `probe`
+// bytes first, since a chunk load would not pay for itself there.
+template<class Chunk, class Byte>
+inline size_t find(std::string_view text, size_t i, Chunk stop_chunk, Byte stop, size_t probe = 0) {
+#ifdef OPL_SIMD_WIDTH
+    for (size_t end = (i + probe < text.size())? i + probe : text.size(); i < end; ++i)
+        if (stop(text[i])) return i;
+    for (; i + OPL_SIMD_WIDTH <= text.size(); i += OPL_SIMD_WIDTH) {
+        uint32_t mask = stop_chunk(Bytes::load(text.data() + i)).mask();
+        if (mask) return i + lowest_bit(mask);
+    }
+#else
+    (void)stop_chunk, (void)probe;
+#endif
+    while (i < text.size() && !stop(text[i])) ++i;
+    return i;
+}
+
+// Bytes probed one at a time before scanning identifiers and whitespace by chunk.
+const size_t PROBE = 8;
+
+inline bool is_id_byte(char c) {
+    return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_';
+}
+
+inline bool is_space_byte(char c) { return c == ' ' || ('\t' <= c && c <= '\r'); }
+
+// First byte equal to `a` or `b`, or a NUL, which ends the lexer's input.
+inline size_t find_either(std::string_view text, size_t i, char a, char b) {
+#ifdef OPL_SIMD_WIDTH
+    Bytes va = Bytes::splat(a), vb = Bytes::splat(b), zero = Bytes::splat(0);
+    auto chunk = [=](Bytes c) { return (c == va) | (c == vb) | (c == zero); };
+#else
+    auto chunk = 0;
+#endif
+    return find(text, i, chunk, [=](char c) { return c == a || c == b || c == 0; });
+}
+
+// First newline ("\n" or "\r") at or after `i`.
+inline size_t find_newline(std::string_view text, size_t i) {
+#ifdef OPL_SIMD_WIDTH
+    Bytes lf = Bytes::splat('\n'), cr = Bytes::splat('\r');
+    auto chunk = [=](Bytes c) { return (c == lf) | (c == cr); };
+#else
+    auto chunk = 0;
+#endif
+    return find(text, i, chunk, [](char c) { return c == '\n' || c == '\r'; });
+}
+
+// End of the run of [A-Za-z0-9_] starting at `i`.
+inline size_t skip_id(std::string_view text, size_t i) {
+#ifdef OPL_SIMD_WIDTH
+    auto chunk = [](Bytes c) {
+        Bytes lower = c | Bytes::splat(0x20);
+        return ~(in_range(lower, 'a', 'z') | in_range(c, '0', '9') | (c == Bytes::splat('_')));
+    };
+#else
+    auto chunk = 0;
+#endif
+    return find(text, i, chunk, [](char c) { return !is_id_byte(c); }, PROBE);
+}
+
+// End of the run of whitespace starting at `i`.
+inline size_t skip_space(std::string_view text, size_t i) {
+#ifdef OPL_SIMD_WIDTH
+    auto chunk = [](Bytes c) { return ~((c == Bytes::splat(' ')) | in_range(c, '\t', '\r')); };
+#else
+    auto chunk = 0;
+#endif
+    return find(text, i, chunk, [](char c) { return !is_space_byte(c); }, PROBE);
+}
+
+}
+
+#endif
@@ -0,0 +1,37 @@
+# Runs one script and compares what it prints with its expected output.
+#   cmake -DOPL=<binary> -DMODE=interpreter|vm|register-vm -DSCRIPT=<file>
+#         -DEXPECTED=<file> [-DCACHE_ENTRIES=<n>] -P run_test.cmake
+# The environment (OPL_CACHE_DIR, OPL_GC_THRESHOLD, ...) is set by ctest. With
+# CACHE_ENTRIES, $OPL_CACHE_DIR must hold exactly that many entries afterwards.
+
+if (MODE STREQUAL "vm")
+    set(flags --vm)
+elseif (MODE STREQUAL "register-vm")
+    set(flags --register-vm)
+else ()
+    set(flags)
+endif ()
+
+execute_process(COMMAND ${OPL} ${flags} ${SCRIPT}
+        OUTPUT_VARIABLE output
+        ERROR_VARIABLE errors
+        RESULT_VARIABLE result)
+
+# Builds with TEST defined print a banner for their built-in demo first.
+string(REGEX REPLACE "^\\[[^\n]*\\] OUTPUT:\n" "" output "${output}")
+file(READ ${EXPECTED} expected)
+
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "${SCRIPT} exited with ${result}\n${output}${errors}")
+endif ()
+if (NOT output STREQUAL expected)
+    message(FATAL_ERROR "${SCRIPT} printed\n${output}\nexpected\n${expected}")
+endif ()
+
+if (DEFINED CACHE_ENTRIES)
+    file(GLOB entries "$ENV{OPL_CACHE_DIR}/*.ast")
+    list(LENGTH entries count)
+    if (NOT count EQUAL CACHE_ENTRIES)
+        message(FATAL_ERROR "$ENV{OPL_CACHE_DIR} holds ${count} entries, expected ${CACHE_ENTRIES}")
+    endif ()
+endif ()
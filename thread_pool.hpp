@@ -0,0 +1,62 @@
+#ifndef OPL_THREAD_POOL_HPP
+#define OPL_THREAD_POOL_HPP
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads taking jobs from one queue. The destructor
+// finishes the queued jobs and joins the workers.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned workers = std::thread::hardware_concurrency()) {
+        if (workers == 0) workers = 1;
+        for (unsigned i = 0; i < workers; ++i) threads.emplace_back([this] { work(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            jobs.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> jobs;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void work() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+
+#endif